@@ -24,6 +24,7 @@ void MainMenu::update( double dt_sec )
 
 void MainMenu::render( double dt_sec )
 {
+	m_rend->command_list().push( vv::ClearCmd{ 0.1f, 0.1f, 0.12f, 1.0f } );
 }
 
 void MainMenu::on_event( const SDL_Event &event )
@@ -0,0 +1,112 @@
+// Compares the throughput of the render command queue implementations:
+// the old mutex + condition_variable + deque path against the SPSC ring
+
+#include "vv.hpp"
+#include "threading/spsc_ring.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace vv;
+using dseconds = std::chrono::duration<double, std::ratio<1,1>>;
+
+static constexpr u32 command_count = 4'000'000;
+
+static RenderCmd make_cmd()
+{
+	return RenderCmd(ShutdownCmd());
+}
+
+// What RenderingSystem used before the ring: one lock per push and per pop
+class LockedQueue
+{
+public:
+	void push( const RenderCmd &cmd )
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_queue.push_back(cmd);
+		}
+		m_cv.notify_one();
+	}
+
+	RenderCmd pop()
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+		m_cv.wait(lock, [this]() { return !m_queue.empty(); });
+		RenderCmd cmd = m_queue.front();
+		m_queue.pop_front();
+		return cmd;
+	}
+
+private:
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	std::deque<RenderCmd> m_queue;
+};
+
+static double bench_locked_queue()
+{
+	LockedQueue queue;
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread consumer([&]() {
+		for(u32 i = 0; i < command_count; ++i)
+			queue.pop();
+	});
+
+	for(u32 i = 0; i < command_count; ++i)
+		queue.push(make_cmd());
+
+	consumer.join();
+	return dseconds(std::chrono::steady_clock::now() - start).count();
+}
+
+static double bench_spsc_ring( const WaitStrategy &strategy )
+{
+	auto ring = std::make_unique<SpscRing<RenderCmd, 4096>>();
+	ring->set_wait_strategy(strategy);
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread consumer([&]() {
+		u32 received = 0;
+		while(received < command_count)
+		{
+			ring->wait_for_data();
+			received += ring->consume_all([](RenderCmd &) {});
+		}
+	});
+
+	for(u32 i = 0; i < command_count; ++i)
+		ring->push(make_cmd());
+
+	consumer.join();
+	return dseconds(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report( const char *name, double seconds )
+{
+	std::printf("%-28s %8.3f s  %10.2f Mcmd/s\n", name, seconds, command_count / seconds / 1e6);
+}
+
+int main()
+{
+	WaitStrategy park_only;
+	park_only.spin_count = 0;
+	park_only.yield_count = 0;
+
+	WaitStrategy spin_only;
+	spin_only.park = false;
+
+	std::printf("%u commands of %zu bytes\n", command_count, sizeof(RenderCmd));
+	report("mutex + cv + deque", bench_locked_queue());
+	report("spsc ring (default)", bench_spsc_ring(WaitStrategy()));
+	report("spsc ring (park only)", bench_spsc_ring(park_only));
+	report("spsc ring (spin / yield)", bench_spsc_ring(spin_only));
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+// Sorts 100k draw items on their 64 bits key, radix sort against std::sort,
+// and counts the shader / material switches left after sorting
+
+#include "vv.hpp"
+#include "graphics/draw_item.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace vv;
+using dmilliseconds = std::chrono::duration<double, std::milli>;
+
+static constexpr u32 item_count = 100'000;
+static constexpr u32 iterations = 50;
+
+static std::vector<DrawSortEntry> make_entries()
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<u32> layer(0, 1);
+	std::uniform_int_distribution<u32> shader(0, 15);
+	std::uniform_int_distribution<u32> material(0, 63);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+	std::uniform_int_distribution<u32> translucent(0, 99);
+
+	std::vector<DrawSortEntry> entries(item_count);
+	for(u32 i = 0; i < item_count; ++i)
+	{
+		// roughly what the dune scene looks like: mostly opaque, some water and decals
+		DrawPass pass = translucent(rng) < 15 ? DrawPass::translucent : DrawPass::opaque;
+		entries[i] = DrawSortEntry{ draw_key::make(layer(rng), pass, shader(rng), material(rng), depth(rng)), i };
+	}
+
+	return entries;
+}
+
+// program and material changes needed to draw the entries in this order
+static u32 count_switches( const std::vector<DrawSortEntry> &entries )
+{
+	u32 switches = 0;
+	u64 previous = ~u64(0);
+	for(const DrawSortEntry &entry: entries)
+	{
+		u64 state = draw_key::pass(entry.key) == DrawPass::opaque
+			? entry.key >> draw_key::depth_bits
+			: entry.key & draw_key::mask(draw_key::shader_bits + draw_key::material_bits);
+		switches += state != previous;
+		previous = state;
+	}
+	return switches;
+}
+
+template <typename Sort>
+static double bench( const std::vector<DrawSortEntry> &input, std::vector<DrawSortEntry> &output, Sort &&sort )
+{
+	double best = 1e30;
+	for(u32 i = 0; i < iterations; ++i)
+	{
+		output = input;
+		auto start = std::chrono::steady_clock::now();
+		sort(output);
+		best = std::min(best, dmilliseconds(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+int main()
+{
+	std::vector<DrawSortEntry> input = make_entries();
+	std::vector<DrawSortEntry> scratch(item_count);
+	std::vector<DrawSortEntry> radix_sorted, std_sorted;
+
+	double radix_ms = bench(input, radix_sorted, [&](std::vector<DrawSortEntry> &entries) {
+		radix_sort(entries.data(), scratch.data(), entries.size());
+	});
+
+	double std_ms = bench(input, std_sorted, [](std::vector<DrawSortEntry> &entries) {
+		std::stable_sort(entries.begin(), entries.end(), [](const DrawSortEntry &a, const DrawSortEntry &b) { return a.key < b.key; });
+	});
+
+	bool same = std::equal(radix_sorted.begin(), radix_sorted.end(), std_sorted.begin(),
+		[](const DrawSortEntry &a, const DrawSortEntry &b) { return a.key == b.key && a.index == b.index; });
+
+	std::printf("%u draw items, best of %u runs\n", item_count, iterations);
+	std::printf("radix sort        %8.3f ms\n", radix_ms);
+	std::printf("std::stable_sort  %8.3f ms\n", std_ms);
+	std::printf("state switches    %u unsorted, %u sorted\n", count_switches(input), count_switches(radix_sorted));
+	std::printf("results match     %s\n", same ? "yes" : "NO");
+
+	return same ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+// Measures how long a log call blocks the calling thread: the asynchronous
+// logger against the old synchronous path (to_string every argument, lock,
+// format in a stringstream, write). Both write to a sink that drops the text,
+// so only the cost paid at the call site is compared. "filtered" is the same
+// call below Logger::level(), what a disabled log left in a hot loop costs.
+//
+// Then the sinks alone: the same records written as text to /dev/null and as
+// binary records to a memory-mapped file, time per record and bytes produced.
+
+#include "vv.hpp"
+#include "logging/binary_log_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+using namespace vv;
+
+static constexpr u32 burst_size = 256;
+static constexpr u32 burst_count = 400;
+static constexpr u32 sink_record_count = 1000000;
+
+// Formats the records like the console does, then drops them
+class NullSink: public LogSink
+{
+public:
+	void write( const LogRecordView &record ) override
+	{
+		char line[log_max_line];
+		format_log_record(record.site, record.args, record.args_size, line, sizeof(line));
+	}
+};
+
+// Keeps a copy of the last record
+class CaptureSink: public LogSink
+{
+public:
+	void write( const LogRecordView &record ) override
+	{
+		site_id = record.site_id;
+		args.assign(record.args, record.args + record.args_size);
+	}
+
+	u32 site_id = 0;
+	std::vector<unsigned char> args;
+};
+
+class NullBuffer: public std::streambuf
+{
+protected:
+	int overflow( int c ) override { return c; }
+	std::streamsize xsputn( const char *, std::streamsize count ) override { return count; }
+};
+
+inline std::string to_string( const std::string &str ) { return str; }
+
+// What Logger::log did before: one string per argument, a global lock and a stringstream
+class LegacyLogger
+{
+public:
+	template <typename ...types>
+	void log( types&& ...args )
+	{
+		using ::to_string;
+		using std::to_string;
+		send_to_streams( { std::string("[INFO ]:"), to_string(args)... } );
+	}
+
+private:
+	void send_to_streams( std::initializer_list<std::string> init_list )
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		std::stringstream ss;
+
+		for(auto &el: init_list)
+			ss << el << ' ';
+
+		ss << '\n';
+		m_out << ss.str();
+	}
+
+	std::mutex m_mtx;
+	NullBuffer m_buffer;
+	std::ostream m_out { &m_buffer };
+};
+
+static void print_latencies( const char *name, std::vector<u64> &samples )
+{
+	std::sort(samples.begin(), samples.end());
+	auto at = [&samples]( double percentile ) {
+		return samples[std::min(samples.size() - 1, static_cast<std::size_t>(percentile * samples.size()))];
+	};
+
+	std::printf("%-10s p50 %6llu ns   p90 %6llu ns   p99 %6llu ns   p99.9 %7llu ns   max %8llu ns\n", name,
+		static_cast<unsigned long long>(at(0.5)), static_cast<unsigned long long>(at(0.9)),
+		static_cast<unsigned long long>(at(0.99)), static_cast<unsigned long long>(at(0.999)),
+		static_cast<unsigned long long>(samples.back()));
+}
+
+template <typename LogFunction>
+static std::vector<u64> measure( LogFunction &&log_function, bool flush_async )
+{
+	std::vector<u64> samples;
+	samples.reserve(burst_size * burst_count);
+
+	const std::string player = "player_42";
+
+	for(u32 burst = 0; burst < burst_count; ++burst)
+	{
+		for(u32 i = 0; i < burst_size; ++i)
+		{
+			u64 start = Logger::now();
+			log_function(player, burst * burst_size + i);
+			samples.push_back(Logger::now() - start);
+		}
+
+		// bursts stay far below the ring size, the logger thread catches up in between
+		if( flush_async )
+			Logger::get().flush();
+	}
+
+	return samples;
+}
+
+// Writes `count` copies of one record to `sink`, returns the nanoseconds per record
+static double measure_sink( LogSink &sink, u32 site_id, const LogSite &site, const std::vector<unsigned char> &args )
+{
+	u64 start = Logger::now();
+	for(u32 i = 0; i < sink_record_count; ++i)
+	{
+		LogRecordView record { site, site_id, 0, Logger::now(), args.data(), static_cast<u32>(args.size()) };
+		sink.write(record);
+		if( (i & 255) == 255 )
+			sink.flush();
+	}
+	sink.flush();
+	return static_cast<double>(Logger::now() - start) / sink_record_count;
+}
+
+static void compare_sinks()
+{
+	// a record as the logger encodes it, after the first call of its line
+	// handed the string literals to the site
+	auto capture = std::make_unique<CaptureSink>();
+	CaptureSink &captured = *capture;
+	Logger::get().clear_sinks();
+	Logger::get().add_sink( std::move(capture) );
+
+	const std::string player = "player_42";
+	for(u32 i = 0; i < 2; ++i)
+		VV_INFO("frame", 123456u, "player", player, "position", 12.5f, -3.25f);
+	Logger::get().flush();
+
+	u32 site_id = captured.site_id;
+	std::vector<unsigned char> args = captured.args;
+	const LogSite &site = Logger::get().site(site_id);
+	Logger::get().clear_sinks();
+
+	std::FILE *dev_null = std::fopen("/dev/null", "wb");
+	if( dev_null == nullptr )
+		return;
+
+	ConsoleSink console(dev_null);
+	double console_ns = measure_sink(console, site_id, site, args);
+	std::fclose(dev_null);
+
+	// every record formats to the same line
+	char line[log_max_line];
+	std::size_t line_size = format_log_record(site, args.data(), args.size(), line, sizeof(line));
+
+	const char *path = "vroum_bench_log.vvlog";
+	double binary_ns = 0.0;
+	u64 binary_bytes = 0;
+	{
+		BinaryLogSink binary(path);
+		binary_ns = measure_sink(binary, site_id, site, args);
+		binary_bytes = binary.size();
+	}
+	std::remove(path);
+
+	std::printf("\nsink cost, %u records\n", sink_record_count);
+	std::printf("%-10s %7.1f ns/record   %6.1f bytes/record\n", "console", console_ns, static_cast<double>(line_size));
+	std::printf("%-10s %7.1f ns/record   %6.1f bytes/record\n", "binary", binary_ns, static_cast<double>(binary_bytes) / sink_record_count);
+}
+
+int main()
+{
+	Logger::get().clear_sinks();
+	Logger::get().add_sink( std::make_unique<NullSink>() );
+
+	LegacyLogger legacy;
+
+	std::vector<u64> legacy_samples = measure([&legacy]( const std::string &player, u32 i ) {
+		legacy.log("frame", i, "player", player, "position", 12.5f, -3.25f);
+	}, false);
+
+	std::vector<u64> async_samples = measure([]( const std::string &player, u32 i ) {
+		VV_INFO("frame", i, "player", player, "position", 12.5f, -3.25f);
+	}, true);
+
+	// counts evaluations of an argument, the level check must come first
+	Logger::set_level(LogLevel::warn);
+	u32 evaluated = 0;
+	std::vector<u64> filtered_samples = measure([&evaluated]( const std::string &player, u32 i ) {
+		VV_LOG_AT(LogLevel::info, "frame", i, "player", player, "position", (++evaluated, 12.5f), -3.25f);
+	}, false);
+	Logger::set_level(LogLevel::trace);
+	if( evaluated != 0 )
+		std::printf("filtered calls evaluated their arguments %u times\n", evaluated);
+
+	std::printf("call site latency, %u calls\n", burst_size * burst_count);
+	print_latencies("legacy", legacy_samples);
+	print_latencies("async", async_samples);
+	print_latencies("filtered", filtered_samples);
+
+	compare_sinks();
+
+	return 0;
+}
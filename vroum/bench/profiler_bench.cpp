@@ -0,0 +1,74 @@
+// Cost of one VV_PROFILE_SCOPE zone: idle (no capture, no flight recorder),
+// while capturing, and with the flight recorder on as the engine runs it.
+// Build with VROUM_PROFILER, without it every zone compiles to nothing.
+
+#include "vv.hpp"
+
+#include <cstdio>
+
+using namespace vv;
+
+static constexpr u32 zones_per_batch = Profiler::zones_per_thread - 16;
+static constexpr u32 batch_count = 20;
+
+static volatile u32 g_sink = 0;
+
+static double measure_zone()
+{
+	u64 total = 0;
+	for(u32 batch = 0; batch < batch_count; ++batch)
+	{
+		bool capturing = Profiler::capturing();
+		if( capturing )
+			Profiler::begin_capture();
+
+		u64 start = Logger::now();
+		for(u32 i = 0; i < zones_per_batch; ++i)
+		{
+			VV_PROFILE_SCOPE("bench zone");
+			g_sink = g_sink + i;
+		}
+		total += Logger::now() - start;
+	}
+
+	return static_cast<double>(total) / (static_cast<double>(zones_per_batch) * batch_count);
+}
+
+static double measure_empty()
+{
+	u64 start = Logger::now();
+	for(u32 batch = 0; batch < batch_count; ++batch)
+	{
+		for(u32 i = 0; i < zones_per_batch; ++i)
+			g_sink = g_sink + i;
+	}
+	return static_cast<double>(Logger::now() - start) / (static_cast<double>(zones_per_batch) * batch_count);
+}
+
+int main()
+{
+	if( !Profiler::enabled )
+		std::printf("VV_PROFILER is off, the zones below are compiled out\n");
+
+	set_thread_name("bench");
+	Profiler::init();
+
+	double empty = measure_empty();
+	double idle = measure_zone();
+
+	Profiler::begin_capture();
+	double capturing = measure_zone();
+	Profiler::end_capture("vroum_bench_profiler.json");
+	std::remove("vroum_bench_profiler.json");
+
+	FlightRecorder::init("", LogLevel::debug);
+	double recorded = measure_zone();
+	FlightRecorder::shutdown();
+
+	std::printf("zone cost, loop overhead (%.1f ns) removed\n", empty);
+	std::printf("%-16s %6.1f ns\n", "idle", idle - empty);
+	std::printf("%-16s %6.1f ns\n", "capturing", capturing - empty);
+	std::printf("%-16s %6.1f ns\n", "flight recorder", recorded - empty);
+
+	return 0;
+}
@@ -0,0 +1,650 @@
+// Boots the engine offscreen and runs scripted scenarios for a fixed number of
+// frames, then prints their frame times and memory use as JSON on stdout (the
+// logs go to stderr):
+//
+//   vroum_bench [--scenario empty|dune|players|all] [--frames N] [--warmup N]
+//               [--players N] [--scene scene.gltf] [--output results.json] [--window]
+//
+//   empty    clears the screen, the cost of the engine itself
+//   dune     the dune scene with the camera orbiting around it
+//   players  the dune scene with N players running around
+//
+// Scenarios only depend on the frame index, two runs submit the same work.
+// There are no per-draw uniforms yet: vertices are transformed on the CPU and
+// uploaded every frame, and drawn with the fallback program. Without the
+// scene's binary buffer, every primitive is replaced by a grid with as many
+// triangles as the original.
+
+#include "vv.hpp"
+#include "graphics/draw_item.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+using namespace vv;
+using json = nlohmann::json;
+using dmilliseconds = std::chrono::duration<double, std::milli>;
+
+#ifndef VROUM_BENCH_SCENE
+	#define VROUM_BENCH_SCENE "resources/models/dune/scene.gltf"
+#endif
+
+enum class Scenario: u8
+{
+	empty,
+	dune,
+	players,
+
+	count
+};
+
+static const char *const s_scenario_names[] = { "empty", "dune", "players" };
+
+struct BenchOptions
+{
+	std::vector<Scenario> scenarios;
+	u32 frames = 600;
+	u32 warmup = 60;
+	u32 players = 256;
+	std::string scene = VROUM_BENCH_SCENE;
+	std::string output;
+	bool window = false;
+};
+
+struct ScenarioResult
+{
+	Scenario scenario;
+	double wall_ms = 0.0;
+	FrameStatsSummary stats;
+	u64 rss_bytes = 0;
+	u64 peak_rss_bytes = 0;
+	u64 frame_arena_bytes = 0;
+};
+
+// the layer is created by the engine, it reads and writes these
+static BenchOptions g_options;
+static std::vector<ScenarioResult> g_results;
+static bool g_scene_from_gltf = false;
+
+// Resident and peak resident memory of the process, 0 when unknown
+static void memory_usage( u64 &rss, u64 &peak_rss )
+{
+	rss = peak_rss = 0;
+
+#if defined(__linux__)
+	if( std::FILE *statm = std::fopen("/proc/self/statm", "r") )
+	{
+		unsigned long long size = 0, resident = 0;
+		if( std::fscanf(statm, "%llu %llu", &size, &resident) == 2 )
+			rss = resident * static_cast<u64>(sysconf(_SC_PAGESIZE));
+		std::fclose(statm);
+	}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+	rusage usage {};
+	if( getrusage(RUSAGE_SELF, &usage) == 0 )
+	{
+	#if defined(__APPLE__)
+		peak_rss = static_cast<u64>(usage.ru_maxrss);
+	#else
+		peak_rss = static_cast<u64>(usage.ru_maxrss) * 1024;
+	#endif
+	}
+#endif
+}
+
+struct SceneMesh
+{
+	std::vector<glm::vec4> positions; // model space
+	std::vector<u32> indices;
+	glm::mat4 world { 1.0f };
+	glm::vec3 center { 0.0f };        // world space
+	u32 material = 0;
+	bool translucent = false;
+	MeshHandle handle = 0;
+};
+
+static bool read_file( const std::string &path, std::vector<char> &data )
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if( !file )
+		return false;
+
+	data.resize(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	return static_cast<bool>(file.read(data.data(), static_cast<std::streamsize>(data.size())));
+}
+
+static glm::mat4 node_matrix( const json &node )
+{
+	if( node.contains("matrix") )
+	{
+		std::vector<float> values = node["matrix"].get<std::vector<float>>();
+		return values.size() == 16 ? glm::make_mat4(values.data()) : glm::mat4(1.0f);
+	}
+
+	glm::mat4 matrix(1.0f);
+	if( node.contains("translation") )
+	{
+		std::vector<float> t = node["translation"].get<std::vector<float>>();
+		matrix = glm::translate(matrix, glm::vec3(t[0], t[1], t[2]));
+	}
+	if( node.contains("rotation") )
+	{
+		std::vector<float> r = node["rotation"].get<std::vector<float>>();
+		matrix *= glm::mat4_cast(glm::quat(r[3], r[0], r[1], r[2]));
+	}
+	if( node.contains("scale") )
+	{
+		std::vector<float> s = node["scale"].get<std::vector<float>>();
+		matrix = glm::scale(matrix, glm::vec3(s[0], s[1], s[2]));
+	}
+	return matrix;
+}
+
+// Grid over the primitive's bounds with about `triangle_count` triangles
+static void make_proxy( SceneMesh &mesh, const glm::vec3 &min, const glm::vec3 &max, u32 triangle_count )
+{
+	u32 columns = std::max(1u, static_cast<u32>(std::sqrt(triangle_count / 2.0)));
+	u32 rows = std::max(1u, triangle_count / (2 * columns));
+
+	for(u32 y = 0; y <= rows; ++y)
+	{
+		for(u32 x = 0; x <= columns; ++x)
+		{
+			float u = static_cast<float>(x) / columns;
+			float v = static_cast<float>(y) / rows;
+			float height = 0.5f + 0.5f * std::sin(u * 12.0f) * std::cos(v * 9.0f);
+			mesh.positions.emplace_back(glm::mix(min.x, max.x, u), glm::mix(min.y, max.y, v), glm::mix(min.z, max.z, height), 1.0f);
+		}
+	}
+
+	for(u32 y = 0; y < rows; ++y)
+	{
+		for(u32 x = 0; x < columns; ++x)
+		{
+			u32 corner = y * (columns + 1) + x;
+			u32 quad[6] = { corner, corner + 1, corner + columns + 2, corner, corner + columns + 2, corner + columns + 1 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Accessor data straight from the binary buffer, false when it doesn't fit
+static bool read_accessor( const json &gltf, const std::vector<char> &buffer, u32 index, SceneMesh &mesh, bool positions )
+{
+	const json &accessor = gltf["accessors"][index];
+	const json &view = gltf["bufferViews"][accessor.value("bufferView", 0u)];
+	u64 offset = view.value("byteOffset", 0ull) + accessor.value("byteOffset", 0ull);
+	u32 count = accessor["count"].get<u32>();
+	u32 component = accessor["componentType"].get<u32>();
+
+	if( positions )
+	{
+		u64 stride = view.value("byteStride", 12ull);
+		if( component != GL_FLOAT || offset + stride * (count - 1) + 12 > buffer.size() )
+			return false;
+
+		for(u32 i = 0; i < count; ++i)
+		{
+			float xyz[3];
+			std::memcpy(xyz, buffer.data() + offset + stride * i, sizeof(xyz));
+			mesh.positions.emplace_back(xyz[0], xyz[1], xyz[2], 1.0f);
+		}
+		return true;
+	}
+
+	u64 size = component == GL_UNSIGNED_INT ? 4 : component == GL_UNSIGNED_SHORT ? 2 : 1;
+	if( offset + size * count > buffer.size() )
+		return false;
+
+	for(u32 i = 0; i < count; ++i)
+	{
+		u32 value = 0;
+		std::memcpy(&value, buffer.data() + offset + size * i, size); // little endian
+		mesh.indices.push_back(value);
+	}
+	return true;
+}
+
+static bool load_scene( const std::string &path, std::vector<SceneMesh> &meshes )
+{
+	std::ifstream file(path);
+	json gltf = json::parse(file, nullptr, false);
+	if( gltf.is_discarded() || !gltf.contains("meshes") || !gltf.contains("nodes") )
+	{
+		VV_ERROR("Cannot read the scene", path);
+		return false;
+	}
+
+	// the geometry is optional, bounds and counts are enough for the proxies
+	std::vector<char> buffer;
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+	if( gltf.contains("buffers") && gltf["buffers"][0].contains("uri") )
+		g_scene_from_gltf = read_file(directory + gltf["buffers"][0]["uri"].get<std::string>(), buffer);
+
+	if( !g_scene_from_gltf )
+		VV_WARN("No binary buffer next to", path, ", drawing proxy geometry");
+
+	struct PendingNode { u32 node; glm::mat4 parent; };
+	std::vector<PendingNode> pending;
+	for(const json &root: gltf["scenes"][gltf.value("scene", 0u)]["nodes"])
+		pending.push_back({ root.get<u32>(), glm::mat4(1.0f) });
+
+	while( !pending.empty() )
+	{
+		PendingNode current = pending.back();
+		pending.pop_back();
+
+		const json &node = gltf["nodes"][current.node];
+		glm::mat4 world = current.parent * node_matrix(node);
+
+		for(const json &child: node.value("children", json::array()))
+			pending.push_back({ child.get<u32>(), world });
+
+		if( !node.contains("mesh") )
+			continue;
+
+		for(const json &primitive: gltf["meshes"][node["mesh"].get<u32>()]["primitives"])
+		{
+			if( primitive.value("mode", 4u) != GL_TRIANGLES || !primitive.contains("indices") )
+				continue;
+
+			SceneMesh mesh;
+			mesh.world = world;
+			mesh.material = primitive.value("material", 0u);
+			if( gltf.contains("materials") && mesh.material < gltf["materials"].size() )
+				mesh.translucent = gltf["materials"][mesh.material].value("alphaMode", "OPAQUE") == "BLEND";
+
+			const json &position = gltf["accessors"][primitive["attributes"]["POSITION"].get<u32>()];
+			glm::vec3 min = glm::make_vec3(position["min"].get<std::vector<float>>().data());
+			glm::vec3 max = glm::make_vec3(position["max"].get<std::vector<float>>().data());
+			mesh.center = glm::vec3(world * glm::vec4((min + max) * 0.5f, 1.0f));
+
+			bool loaded = g_scene_from_gltf
+				&& read_accessor(gltf, buffer, primitive["attributes"]["POSITION"].get<u32>(), mesh, true)
+				&& read_accessor(gltf, buffer, primitive["indices"].get<u32>(), mesh, false);
+
+			if( !loaded )
+			{
+				g_scene_from_gltf = false;
+				mesh.positions.clear();
+				mesh.indices.clear();
+				make_proxy(mesh, min, max, gltf["accessors"][primitive["indices"].get<u32>()]["count"].get<u32>() / 3);
+			}
+
+			meshes.push_back(std::move(mesh));
+		}
+	}
+
+	return !meshes.empty();
+}
+
+// loaded before the engine starts
+static std::vector<SceneMesh> g_scene;
+
+static const glm::vec3 s_cube_corners[8] = {
+	{ -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+	{ -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 },
+};
+
+static const u32 s_cube_indices[36] = {
+	0, 1, 2, 2, 3, 0,  4, 6, 5, 6, 4, 7,  0, 4, 5, 5, 1, 0,
+	3, 2, 6, 6, 7, 3,  1, 5, 6, 6, 2, 1,  0, 3, 7, 7, 4, 0,
+};
+
+class BenchLayer: public Layer
+{
+public:
+	Error init() override
+	{
+		m_meshes = std::move(g_scene);
+
+		glm::vec3 min(1e30f), max(-1e30f);
+		for(SceneMesh &mesh: m_meshes)
+		{
+			mesh.handle = m_rend->create_mesh(nullptr, static_cast<u32>(mesh.positions.size()), mesh.indices.data(), static_cast<u32>(mesh.indices.size()), true);
+			for(const glm::vec4 &position: mesh.positions)
+			{
+				glm::vec3 world = glm::vec3(mesh.world * position);
+				min = glm::min(min, world);
+				max = glm::max(max, world);
+			}
+		}
+
+		if( !m_meshes.empty() )
+		{
+			m_scene_center = (min + max) * 0.5f;
+			m_scene_radius = glm::length(max - min) * 0.5f;
+		}
+
+		// one cube per player, all of them in one buffer
+		if( g_options.players > 0 )
+			m_players_mesh = m_rend->create_mesh(nullptr, g_options.players * 8, s_cube_indices, 36, true);
+
+		m_players.resize(g_options.players);
+		return Error::ok;
+	}
+
+	void shutdown() override {}
+
+	void on_event( const SDL_Event & ) override {}
+
+	void update( double ) override
+	{
+		if( m_frame == g_options.warmup )
+			m_start = std::chrono::steady_clock::now();
+
+		if( m_frame == g_options.warmup + g_options.frames )
+		{
+			finish_scenario();
+			if( ++m_scenario == g_options.scenarios.size() )
+			{
+				m_app->quit();
+				return;
+			}
+			m_frame = 0;
+		}
+
+		// fixed steps rather than the measured delta time
+		float time = m_frame / 60.0f;
+		float angle = time * 0.5f;
+		glm::vec3 eye = m_scene_center + glm::vec3(std::cos(angle), 0.35f, std::sin(angle)) * m_scene_radius * 1.6f;
+		m_view = glm::lookAt(eye, m_scene_center, glm::vec3(0.0f, 1.0f, 0.0f));
+		m_eye = eye;
+
+		if( scenario() == Scenario::players )
+		{
+			m_app->jobs().parallel_for(0, static_cast<u32>(m_players.size()), 0, [this, time]( u32 begin, u32 end ) {
+				for(u32 i = begin; i < end; ++i)
+				{
+					// every player runs its own circle, golden angle apart
+					float radius = m_scene_radius * (0.1f + 0.6f * static_cast<float>((i * 37) % 101) / 100.0f);
+					float phase = static_cast<float>(i) * 2.39996f + time * (0.3f + 0.002f * static_cast<float>(i % 50));
+					m_players[i] = m_scene_center + glm::vec3(std::cos(phase) * radius, 0.0f, std::sin(phase) * radius);
+				}
+			});
+		}
+
+		++m_frame;
+	}
+
+	void render( double ) override
+	{
+		if( m_scenario == g_options.scenarios.size() )
+			return;
+
+		CommandList &list = m_rend->command_list();
+		list.push(ClearCmd{ 0.1f, 0.1f, 0.12f, 1.0f });
+
+		if( scenario() == Scenario::empty )
+			return;
+
+		glm::mat4 view_projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, m_scene_radius * 0.05f, m_scene_radius * 4.0f) * m_view;
+
+		for(const SceneMesh &mesh: m_meshes)
+		{
+			float depth = glm::length(mesh.center - m_eye) / (m_scene_radius * 4.0f);
+			DrawPass pass = mesh.translucent ? DrawPass::translucent : DrawPass::opaque;
+			submit(list, mesh.handle, mesh.positions.data(), static_cast<u32>(mesh.positions.size()), view_projection * mesh.world,
+				draw_key::make(0, pass, 0, mesh.material, depth), static_cast<i32>(mesh.indices.size()), 1);
+		}
+
+		if( scenario() == Scenario::players && !m_players.empty() )
+			submit_players(list, view_projection);
+	}
+
+private:
+	Scenario scenario() const { return g_options.scenarios[m_scenario]; }
+
+	// Projects on the CPU straight into the upload, the fallback program draws positions as they are
+	static void project( const glm::mat4 &transform, const glm::vec4 *positions, glm::vec4 *out, u32 count )
+	{
+		for(u32 i = 0; i < count; ++i)
+		{
+			glm::vec4 clip = transform * positions[i];
+			out[i] = clip.w > 1e-5f ? glm::vec4(glm::vec3(clip) / clip.w, 1.0f) : glm::vec4(0.0f, 0.0f, 2.0f, 1.0f); // behind the camera: clipped
+		}
+	}
+
+	// Uploads the projected vertices and records `draw_count` draws of `index_count` indices, one per group of vertices
+	void submit( CommandList &list, MeshHandle handle, const glm::vec4 *positions, u32 vertex_count, const glm::mat4 &transform,
+		u64 key, i32 index_count, u32 draw_count )
+	{
+		MeshBuffers buffers = m_rend->mesh_buffers(handle);
+		if( buffers.vertex_array == 0 )
+			return; // not created yet, warmup frames only
+
+		glm::vec4 *projected = list.arena().allocate_array<glm::vec4>(vertex_count);
+		m_app->jobs().parallel_for(0, vertex_count, 4096, [&]( u32 begin, u32 end ) {
+			project(transform, positions + begin, projected + begin, end - begin);
+		});
+
+		UploadBufferCmd upload;
+		upload.target = GL_ARRAY_BUFFER;
+		upload.buffer = buffers.vertex_buffer;
+		upload.size = u64(vertex_count) * sizeof(glm::vec4);
+		upload.data = projected;
+		list.push(upload);
+
+		u32 vertices_per_draw = vertex_count / draw_count;
+		for(u32 i = 0; i < draw_count; ++i)
+		{
+			DrawItem item;
+			item.key = key;
+			item.vao = buffers.vertex_array;
+			item.mode = GL_TRIANGLES;
+			item.index_type = GL_UNSIGNED_INT;
+			item.count = index_count;
+			item.first = static_cast<i32>(i * vertices_per_draw);
+			list.submit_draw(item);
+		}
+	}
+
+	void submit_players( CommandList &list, const glm::mat4 &view_projection )
+	{
+		// cubes are built in world space, one draw each
+		float half = m_scene_radius * 0.01f;
+		m_player_vertices.resize(m_players.size() * 8);
+		for(std::size_t i = 0; i < m_players.size(); ++i)
+		{
+			for(u32 corner = 0; corner < 8; ++corner)
+				m_player_vertices[i * 8 + corner] = glm::vec4(m_players[i] + s_cube_corners[corner] * half, 1.0f);
+		}
+
+		submit(list, m_players_mesh, m_player_vertices.data(), static_cast<u32>(m_player_vertices.size()), view_projection,
+			draw_key::make(0, DrawPass::opaque, 0, 100, 0.5f), 36, static_cast<u32>(m_players.size()));
+	}
+
+	void finish_scenario()
+	{
+		ScenarioResult result;
+		result.scenario = scenario();
+		result.wall_ms = dmilliseconds(std::chrono::steady_clock::now() - m_start).count();
+		result.stats = m_app->frame_stats().summarize(g_options.frames);
+		result.frame_arena_bytes = m_app->frame_arena().capacity();
+		memory_usage(result.rss_bytes, result.peak_rss_bytes);
+		g_results.push_back(result);
+
+		VV_INFO("Scenario", s_scenario_names[static_cast<u32>(result.scenario)], "done:",
+			result.stats.time(FrameMetric::frame).avg, "ms per frame on average");
+	}
+
+	std::vector<SceneMesh> m_meshes;
+	glm::vec3 m_scene_center { 0.0f };
+	float m_scene_radius = 1.0f;
+
+	MeshHandle m_players_mesh = 0;
+	std::vector<glm::vec3> m_players;
+	std::vector<glm::vec4> m_player_vertices;
+
+	std::size_t m_scenario = 0;
+	u32 m_frame = 0; // in the current scenario, warmup included
+	std::chrono::steady_clock::time_point m_start;
+	glm::mat4 m_view { 1.0f };
+	glm::vec3 m_eye { 0.0f };
+};
+
+static json summary_json( const StatSummary &stat )
+{
+	return json{ { "min", stat.min }, { "avg", stat.avg }, { "p50", stat.p50 }, { "p95", stat.p95 }, { "p99", stat.p99 }, { "max", stat.max } };
+}
+
+static json results_json()
+{
+	json scenarios = json::array();
+	for(const ScenarioResult &result: g_results)
+	{
+		json times, counters;
+		for(u32 metric = 0; metric < static_cast<u32>(FrameMetric::count); ++metric)
+			times[to_string(static_cast<FrameMetric>(metric))] = summary_json(result.stats.times[metric]);
+		for(u32 counter = 0; counter < static_cast<u32>(FrameCounter::count); ++counter)
+			counters[to_string(static_cast<FrameCounter>(counter))] = summary_json(result.stats.counters[counter]);
+
+		scenarios.push_back({
+			{ "name", s_scenario_names[static_cast<u32>(result.scenario)] },
+			{ "frames", result.stats.frame_count },
+			{ "wall_ms", result.wall_ms },
+			{ "fps", result.wall_ms > 0.0 ? result.stats.frame_count * 1000.0 / result.wall_ms : 0.0 },
+			{ "times_ms", times },
+			{ "counters", counters },
+			{ "memory", {
+				{ "rss_bytes", result.rss_bytes },
+				{ "peak_rss_bytes", result.peak_rss_bytes },
+				{ "frame_arena_bytes", result.frame_arena_bytes } } },
+		});
+	}
+
+	return json{
+		{ "frames", g_options.frames },
+		{ "warmup", g_options.warmup },
+		{ "players", g_options.players },
+		{ "scene", g_scene_from_gltf ? "gltf" : "proxy" },
+		{ "profiler", Profiler::enabled },
+		{ "scenarios", scenarios },
+	};
+}
+
+static bool parse_options( int argc, char **argv )
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if( arg == "--scenario" && has_value )
+		{
+			std::string name = argv[++i];
+			if( name == "all" )
+			{
+				for(u32 scenario = 0; scenario < static_cast<u32>(Scenario::count); ++scenario)
+					g_options.scenarios.push_back(static_cast<Scenario>(scenario));
+				continue;
+			}
+
+			u32 scenario = 0;
+			while( scenario < static_cast<u32>(Scenario::count) && name != s_scenario_names[scenario] )
+				++scenario;
+			if( scenario == static_cast<u32>(Scenario::count) )
+			{
+				std::fprintf(stderr, "unknown scenario %s\n", name.c_str());
+				return false;
+			}
+			g_options.scenarios.push_back(static_cast<Scenario>(scenario));
+		}
+		else if( arg == "--frames" && has_value )
+			g_options.frames = std::max(1, std::atoi(argv[++i]));
+		else if( arg == "--warmup" && has_value )
+			g_options.warmup = std::max(2, std::atoi(argv[++i])); // meshes exist after two frames
+		else if( arg == "--players" && has_value )
+			g_options.players = static_cast<u32>(std::max(0, std::atoi(argv[++i])));
+		else if( arg == "--scene" && has_value )
+			g_options.scene = argv[++i];
+		else if( arg == "--output" && has_value )
+			g_options.output = argv[++i];
+		else if( arg == "--window" )
+			g_options.window = true;
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--scenario empty|dune|players|all] [--frames N] [--warmup N] "
+				"[--players N] [--scene scene.gltf] [--output results.json] [--window]\n", argv[0]);
+			return false;
+		}
+	}
+
+	if( g_options.scenarios.empty() )
+		g_options.scenarios = { Scenario::empty, Scenario::dune, Scenario::players };
+
+	return true;
+}
+
+int main( int argc, char **argv )
+{
+	if( !parse_options(argc, argv) )
+		return 1;
+
+	// stdout is for the results
+	Logger::get().clear_sinks();
+	Logger::get().add_sink(std::make_unique<ConsoleSink>(stderr));
+
+	bool needs_scene = false;
+	for(Scenario scenario: g_options.scenarios)
+		needs_scene |= scenario != Scenario::empty;
+
+	if( needs_scene && !load_scene(g_options.scene, g_scene) )
+		return 1;
+
+	EngineParameters params;
+	params.window_title = "vroum_bench";
+	params.window_width = 1280;
+	params.window_height = 720;
+	params.target_fps = 0;
+	params.shader_cache_directory = "";
+	params.flight_recorder_path = "";
+	params.frame_stats_history = g_options.frames;
+	params.offscreen = !g_options.window; // no display needed, Mesa renders on the CPU without a GPU
+
+	Engine engine(params);
+	if( !engine.init_systems() )
+		return 1;
+
+	engine.add_layer<BenchLayer>();
+	engine.run();
+	engine.shutdown_systems();
+
+	if( g_results.size() != g_options.scenarios.size() )
+	{
+		std::fprintf(stderr, "vroum_bench: %zu of %zu scenarios ran\n", g_results.size(), g_options.scenarios.size());
+		return 1;
+	}
+
+	std::string results = results_json().dump(2);
+	if( g_options.output.empty() )
+	{
+		std::printf("%s\n", results.c_str());
+		return 0;
+	}
+
+	std::ofstream output(g_options.output);
+	output << results << '\n';
+	return output ? 0 : 1;
+}
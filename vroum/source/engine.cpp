@@ -1,10 +1,18 @@
 #include "engine.hpp"
+#include "graphics/core/program_cache.hpp"
+#include "memory/alloc_profiler.hpp"
+#include "logging/binary_log_sink.hpp"
+#include "profiling/profiler.hpp"
+#include "threading/thread_name.hpp"
+#include "threading/tick_scheduler.hpp"
 #include <iostream>
 #include <chrono>
-#include <thread>
+#include <cstdlib>
+#include <filesystem>
 
 using namespace vv;
-using dseconds = std::chrono::duration<double, std::ratio<1,1>>;
+using dmilliseconds = std::chrono::duration<double, std::milli>;
+using nanoseconds = std::chrono::nanoseconds;
 
 Engine::Engine( const EngineParameters &params ):
 	m_params(params)
@@ -17,57 +25,269 @@ Engine::~Engine()
 
 void Engine::run()
 {
-	auto current_time = std::chrono::steady_clock::now();
-	double target_dt = 1.0 / m_params.target_fps;
-	double current_dt = target_dt; // special case for the first dt
+	if( m_params.server )
+	{
+		run_server();
+		return;
+	}
+
+	double target_dt = m_params.target_fps > 0 ? 1.0 / m_params.target_fps : 0.0;
+	auto previous_start = std::chrono::steady_clock::now();
+	u64 frame_index = 0;
 
 	while(m_running)
 	{
-		auto previous_time = current_time;
+		// a frame advances the game by the real time since the previous one started,
+		// the first one by target_dt
+		auto frame_start = std::chrono::steady_clock::now();
+		u64 elapsed_ns = frame_index == 0 ? static_cast<u64>(target_dt * 1e9)
+			: static_cast<u64>(std::chrono::duration_cast<nanoseconds>(frame_start - previous_start).count());
+		previous_start = frame_start;
 
-		// Dispatch Events
-		dispatch_events();
+		update_profile_capture();
+
+		FrameSample sample;
+		sample.frame = frame_index;
 
-		// Game update
-		for(auto &layer: m_layers)
 		{
-			layer->update( current_dt );
+			VV_PROFILE_SCOPE("frame");
+			m_frame_arena.begin_frame();
+			update_layers( elapsed_ns, sample );
+
+			if( m_stats_overlay_visible && !m_idle )
+				draw_stats_overlay();
+
+			// the layers recorded their commands, the whole frame is sent at once
+			if( !m_idle )
+			{
+				VV_ALLOC_SCOPE("frame submit");
+				VV_PROFILE_SCOPE("frame submit");
+				auto submit_start = std::chrono::steady_clock::now();
+				m_graphics_sys->submit_frame();
+				sample.time(FrameMetric::submit) = dmilliseconds(std::chrono::steady_clock::now() - submit_start).count();
+			}
 		}
 
-		// Rendering
-		for(auto &layer: m_layers)
+		if( AllocProfiler::enabled )
+			check_frame_allocations( frame_index );
+
+		// Tick update: wait until the frame lasted target_dt
+		{
+			VV_PROFILE_SCOPE("frame pacing");
+			m_pacer.wait( static_cast<u64>(std::chrono::duration_cast<nanoseconds>(frame_start.time_since_epoch()).count()) );
+		}
+
+		sample.time(FrameMetric::frame) = dmilliseconds(std::chrono::steady_clock::now() - frame_start).count();
+		if( m_idle )
+			m_frame_stats.push( sample ); // nothing was rendered
+		else
+			push_frame_stats( sample );
+		++frame_index;
+	}
+}
+
+void Engine::run_server()
+{
+	TickScheduler scheduler;
+	scheduler.start( m_params.server_tick_rate );
+	u64 tick = 0;
+
+	VV_INFO("Server running at", m_params.server_tick_rate, "ticks per second");
+
+	while(m_running)
+	{
+		auto tick_start = std::chrono::steady_clock::now();
+		update_profile_capture();
+
+		FrameSample sample;
+		sample.frame = tick;
+
 		{
-			layer->render( current_dt );
+			VV_PROFILE_SCOPE("tick");
+			m_frame_arena.begin_frame();
+			update_layers( scheduler.period_ns(), sample );
 		}
 
-		// Tick update
-		current_time = std::chrono::steady_clock::now();
-		auto frame_time = current_time - previous_time;
-		double delta_time_seconds = dseconds(frame_time).count();
-		if( delta_time_seconds < target_dt) {
-			// wait until the delta time is target_dt
-			std::this_thread::sleep_for( dseconds(target_dt - delta_time_seconds) );
+		if( AllocProfiler::enabled )
+			check_frame_allocations( tick );
+
+		{
+			VV_PROFILE_SCOPE("wait next tick");
+			scheduler.wait_next_tick();
+		}
+
+		sample.time(FrameMetric::frame) = dmilliseconds(std::chrono::steady_clock::now() - tick_start).count();
+		m_frame_stats.push( sample );
+		++tick;
+	}
+
+	if( scheduler.late_ticks() > 0 )
+		VV_WARN("Server:", scheduler.late_ticks(), "of", tick, "ticks started late,", scheduler.dropped_ticks(), "dropped");
+}
+
+void Engine::step_fixed_updates( u64 elapsed_ns )
+{
+	if( m_fixed_step_ns == 0 )
+		return;
+
+	VV_PROFILE_SCOPE("fixed update");
+
+	// integer nanoseconds, a server ticking at fixed_tick_rate runs exactly one step per tick
+	m_fixed_accumulator_ns += elapsed_ns;
+	double fixed_dt_sec = fixed_dt();
+
+	// idle frames are long on purpose, they catch up on all of theirs
+	u32 max_steps = m_params.max_fixed_steps;
+	if( m_idle )
+		max_steps = std::max(max_steps, m_params.fixed_tick_rate / m_params.idle_tick_rate + 1);
+
+	for(u32 step = 0; step < max_steps && m_fixed_accumulator_ns >= m_fixed_step_ns; ++step)
+	{
+		for(auto &layer: m_layers)
+			layer->fixed_update( fixed_dt_sec );
+
+		m_fixed_accumulator_ns -= m_fixed_step_ns;
+	}
+
+	// too far behind, catching up would only make the next frame longer
+	if( m_fixed_accumulator_ns >= m_fixed_step_ns )
+	{
+		m_dropped_fixed_steps += m_fixed_accumulator_ns / m_fixed_step_ns;
+		m_fixed_accumulator_ns %= m_fixed_step_ns;
+	}
+
+	m_interpolation_alpha = static_cast<double>(m_fixed_accumulator_ns) / static_cast<double>(m_fixed_step_ns);
+}
+
+void Engine::update_layers( u64 elapsed_ns, FrameSample &sample )
+{
+	// Dispatch Events
+	{
+		VV_ALLOC_SCOPE("events");
+		VV_PROFILE_SCOPE("dispatch events");
+		dispatch_events();
+	}
+
+	auto update_start = std::chrono::steady_clock::now();
+
+	// Fixed rate simulation
+	{
+		VV_ALLOC_SCOPE("fixed update");
+		step_fixed_updates( elapsed_ns );
+	}
+
+	// Game update and rendering: layers declare their tasks, independent ones run in parallel
+	{
+		VV_ALLOC_SCOPE("frame graph");
+		VV_PROFILE_SCOPE("frame graph");
+		double dt_sec = static_cast<double>(elapsed_ns) * 1e-9;
+		m_task_graph.clear();
+
+		// no render submission while idle nor on a server, the layers only update
+		if( m_idle || !m_graphics_sys )
+			m_task_graph.skip_writers_of( resources::command_list );
+		for(auto &layer: m_layers)
+		{
+			layer->declare_tasks( m_task_graph, dt_sec );
 		}
 
-		current_dt = std::max( target_dt, delta_time_seconds );
+		m_task_graph.execute( m_jobs );
+		sample.time(FrameMetric::update) = dmilliseconds(std::chrono::steady_clock::now() - update_start).count();
 	}
 }
 
+void Engine::draw_stats_overlay()
+{
+	char text[1024];
+	std::size_t length = format_frame_stats( m_frame_stats.summarize( m_params.stats_overlay_window ), text, sizeof(text) );
+	m_graphics_sys->draw_stats_overlay( text, length );
+}
+
+void Engine::push_frame_stats( FrameSample &sample )
+{
+	RenderFrameStats render = m_graphics_sys->last_frame_stats();
+	sample.time(FrameMetric::render) = render.cpu_ms;
+	sample.time(FrameMetric::gpu) = m_graphics_sys->last_gpu_timing().gpu_ms;
+	sample.counter(FrameCounter::draws) = render.draws;
+	sample.counter(FrameCounter::state_changes) = m_graphics_sys->last_frame_gl_stats().total_issued();
+	sample.counter(FrameCounter::bytes_uploaded) = render.bytes_uploaded;
+
+	m_frame_stats.push( sample );
+}
+
+void Engine::capture_profile( u32 frame_count )
+{
+	m_profile_frames_left = frame_count;
+}
+
+void Engine::update_profile_capture()
+{
+	if( m_profile_frames_left == 0 )
+		return;
+
+	if( !Profiler::capturing() )
+	{
+		Profiler::begin_capture();
+		return;
+	}
+
+	if( --m_profile_frames_left == 0 )
+		Profiler::end_capture( m_params.profile_capture_path );
+}
+
+void Engine::check_frame_allocations( u64 frame_index )
+{
+	const AllocFrameReport &report = AllocProfiler::end_frame();
+
+	if( m_params.alloc_guard_after_frames == 0 || frame_index < m_params.alloc_guard_after_frames )
+		return;
+
+	// drivers and SDL still malloc on their own, only the engine's C++ allocations are checked
+	if( report[AllocSource::cpp_new].count == 0 )
+		return;
+
+	// a hard failure in release builds too, CI runs the guard with NDEBUG
+	AllocProfiler::log_report(report, "Steady state frame allocated");
+	VV_FATAL("Frame", frame_index, "allocated after the first", m_params.alloc_guard_after_frames, "frames");
+	std::abort();
+}
+
 void Engine::dispatch_events()
 {
-	// Save all the events in one array
+	// Save all the events in one array, allocated in the frame arena
 	SDL_Event event;
-	std::vector<SDL_Event> events;
+	FrameAllocator<SDL_Event> allocator(m_frame_arena);
+	std::vector<SDL_Event, FrameAllocator<SDL_Event>> events(allocator);
+	events.reserve(64);
+	bool window_changed = false;
 	while( SDL_PollEvent(&event) )
 	{
 		events.push_back(event);
 
+		if( event.type >= SDL_EVENT_WINDOW_FIRST && event.type <= SDL_EVENT_WINDOW_LAST )
+		{
+			window_changed = true;
+		}
+
+		if( event.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED && m_graphics_sys )
+		{
+			m_graphics_sys->resize( static_cast<u32>(event.window.data1), static_cast<u32>(event.window.data2) );
+		}
+
 		if(event.type == SDL_EVENT_QUIT)
 		{
 			m_running = false;
 		}
+
+		if(event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat && m_params.stats_overlay_key != 0 && event.key.key == m_params.stats_overlay_key)
+		{
+			m_stats_overlay_visible = !m_stats_overlay_visible;
+		}
 	}
 
+	if( window_changed )
+		update_idle_state();
+
 	// and propagate them in order, one layer after the other
 	for(int i = m_layers.size() - 1; i >= 0; --i)
 	{
@@ -76,38 +296,163 @@ void Engine::dispatch_events()
 	}
 }
 
+void Engine::update_idle_state()
+{
+	// an offscreen window is hidden and never focused, it always renders
+	if( m_window == nullptr || m_params.offscreen || m_params.idle_tick_rate == 0 )
+		return;
+
+	SDL_WindowFlags flags = SDL_GetWindowFlags(m_window);
+	bool idle = (flags & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED | SDL_WINDOW_OCCLUDED)) != 0
+		|| (m_params.idle_when_unfocused && (flags & SDL_WINDOW_INPUT_FOCUS) == 0);
+
+	if( idle == m_idle )
+		return;
+
+	m_idle = idle;
+	m_pacer.set_target_fps( idle ? m_params.idle_tick_rate : m_params.target_fps );
+
+	if( idle )
+		VV_INFO("Window inactive, idling at", m_params.idle_tick_rate, "frames per second");
+	else
+		VV_INFO("Window active again");
+}
+
 bool Engine::init_systems()
 {
-	if( !init_window() )
+	set_thread_name("game");
+
+	// the calibration spin happens here rather than in the first profiled zone
+	Profiler::init();
+
+	// a ring per thread is too much for a server running many matches, only on request
+	bool flight_recorder = !m_params.server || m_params.server_flight_recorder;
+	if( flight_recorder && !m_params.flight_recorder_path.empty() )
+		FlightRecorder::init( log_file_path(m_params.flight_recorder_path), m_params.flight_recorder_level );
+
+	if( !m_params.binary_log_path.empty() )
+	{
+		auto sink = std::make_unique<BinaryLogSink>( log_file_path(m_params.binary_log_path) );
+		if( sink->is_open() )
+			Logger::get().add_sink( std::move(sink) );
+	}
+
+	if( m_params.server )
+	{
+		// events only, SDL still turns SIGINT and SIGTERM into SDL_EVENT_QUIT
+		if (! SDL_Init( SDL_INIT_EVENTS ) )
+		{
+			VV_ERROR("Error when calling SDL_Init", SDL_GetError());
+			return false;
+		}
+	}
+	else if( !init_window() )
 	{
 		VV_ERROR("Cannot initialize SDL3");
 		return false;
 	}
 
-	if( !m_graphics_sys.init( m_window ) )
+	u32 job_workers = m_params.job_worker_count;
+	if( m_params.server && job_workers == 0 )
+		job_workers = 1;
+
+	if( !m_jobs.init( job_workers ) )
+	{
+		VV_ERROR("Cannot initialize the job system");
+		return false;
+	}
+
+	// without a render thread nothing outlives the tick, one buffer is enough
+	m_frame_arena.init( m_jobs.thread_count(), m_params.server ? 1 : m_params.frame_arena_buffers );
+
+	m_profile_frames_left = m_params.profile_capture_frames;
+
+	m_frame_stats.init( m_params.frame_stats_history );
+
+	m_fixed_step_ns = m_params.fixed_tick_rate > 0 ? 1000000000ull / m_params.fixed_tick_rate : 0;
+	m_fixed_accumulator_ns = 0;
+	m_interpolation_alpha = 0.0;
+	m_stats_overlay_visible = m_params.show_stats_overlay;
+
+	if( m_params.server )
+		return true;
+
+	FramePacerSettings pacing;
+	pacing.target_fps = m_params.target_fps;
+	pacing.method = m_params.frame_pacing;
+	pacing.spin_us = m_params.frame_pacing_spin_us;
+	pacing.measure = m_params.measure_frame_pacing;
+	m_pacer.init( pacing );
+
+	ProgramBinaryCache::get().set_directory( m_params.shader_cache_directory );
+
+	RenderingSettings render_settings;
+	render_settings.wait_strategy = m_params.render_queue_wait;
+	render_settings.gpu_profiling = m_params.gpu_profiling;
+	render_settings.offscreen = m_params.offscreen;
+	render_settings.vsync = m_params.vsync;
+
+	m_graphics_sys = std::make_unique<RenderingSystem>();
+	if( !m_graphics_sys->init( m_window, render_settings ) )
 	{
 		VV_ERROR("Cannot initialize The graphic system");
 		return false;
 	}
 
+	// no window event comes for a window that starts hidden or unfocused
+	update_idle_state();
+
 	return true;
 }
 
 void Engine::shutdown_systems()
 {
-	m_graphics_sys.shutdown();
+	if( !m_params.frame_stats_csv_path.empty() )
+		m_frame_stats.write_csv( m_params.frame_stats_csv_path );
+
+	if( m_dropped_fixed_steps > 0 )
+		VV_WARN(m_dropped_fixed_steps, "fixed update steps dropped, more than", m_params.max_fixed_steps, "were due in a frame");
+
+	m_pacer.shutdown();
+
+	if( m_graphics_sys )
+		m_graphics_sys->shutdown();
+	m_jobs.shutdown();
 	shutdown_window();
+	FlightRecorder::shutdown();
+}
+
+std::string Engine::log_file_path( const std::string &path ) const
+{
+	std::filesystem::path file(path);
+	if( m_params.log_directory.empty() || file.is_absolute() )
+		return path;
+
+	std::error_code error;
+	std::filesystem::create_directories(m_params.log_directory, error);
+	if( error )
+	{
+		VV_WARN("Cannot create the log directory", m_params.log_directory, error.message());
+		return path;
+	}
+
+	return (std::filesystem::path(m_params.log_directory) / file).string();
 }
 
 void Engine::shutdown_window()
 {
-	SDL_DestroyWindow(m_window);
+	if( m_window != nullptr )
+		SDL_DestroyWindow(m_window);
 }
 
 bool Engine::init_window()
 {
 	assert( m_window == nullptr ); // double initialization
 
+	// EGL with Mesa, no display server needed. SDL_VIDEO_DRIVER still wins
+	if( m_params.offscreen )
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+
 	if (! SDL_Init( SDL_INIT_VIDEO | SDL_INIT_EVENTS) )
 	{
 		VV_ERROR("Error when calling SDL_Init", SDL_GetError());
@@ -115,6 +460,8 @@ bool Engine::init_window()
 	}
 
 	SDL_WindowFlags window_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY;
+	if( m_params.offscreen )
+		window_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN; // the framebuffer keeps the window size
 	m_window = SDL_CreateWindow(m_params.window_title.c_str(), m_params.window_width, m_params.window_height, window_flags );
 
 	if( m_window == nullptr ) {
@@ -122,5 +469,10 @@ bool Engine::init_window()
 		return false;
 	}
 
+	// the rate vsync paces at, target_fps is best a divisor of it
+	const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode( SDL_GetDisplayForWindow(m_window) );
+	if( mode != nullptr && mode->refresh_rate > 0.0f )
+		VV_INFO("Display refresh rate:", mode->refresh_rate, "Hz");
+
 	return true;
 }
\ No newline at end of file
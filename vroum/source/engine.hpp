@@ -3,6 +3,10 @@
 #include "vv_headers.hpp"
 #include "layer.hpp"
 #include "graphics/rendering_system.hpp"
+#include "threading/job_system.hpp"
+#include "threading/frame_pacer.hpp"
+#include "memory/frame_arena.hpp"
+#include "profiling/frame_stats.hpp"
 
 #include <SDL3/SDL.h>
 
@@ -20,7 +24,95 @@ struct EngineParameters
 	u32 window_width = 1920;
 	u32 window_height = 1080;
 
-	u32 target_fps = 30.0;
+	u32 target_fps = 30.0; // 0 for no limit
+
+	// how frames are held to target_fps, the last frame_pacing_spin_us are spun
+	PacingMethod frame_pacing = PacingMethod::sleep_spin;
+	u32 frame_pacing_spin_us = 1000;
+
+	// logs how late the frame pacer woke up on shutdown, in percentiles
+	bool measure_frame_pacing = false;
+
+	// presenting a frame waits for the display refresh, set target_fps to 0
+	// to pace on the display alone
+	VSync vsync = VSync::on;
+
+	// while the window is hidden, minimized or covered the layers still get
+	// their events and updates but nothing is rendered, at idle_tick_rate
+	// frames per second. 0 to always run at full rate
+	u32 idle_tick_rate = 10;
+
+	// losing the focus idles too, the last frame stays on screen
+	bool idle_when_unfocused = true;
+
+	// Layer::fixed_update() ticks per second of game time, 0 to disable. A frame
+	// runs at most max_fixed_steps of them, the simulation slows down past that
+	u32 fixed_tick_rate = 0;
+	u32 max_fixed_steps = 5;
+
+	// how the render thread waits for commands from the game thread
+	WaitStrategy render_queue_wait;
+
+	// worker threads of the job system, 0 for one per core besides the game thread
+	// (a single one on a server, many of them share a machine)
+	u32 job_worker_count = 0;
+
+	// frames a frame arena allocation stays valid for, at most FrameArena::max_buffers
+	u32 frame_arena_buffers = 2;
+
+	// with VROUM_ALLOC_PROFILER, the first frame past this many that calls operator new aborts, 0 to disable
+	u32 alloc_guard_after_frames = 0;
+
+	// linked shader programs are cached here, empty to disable
+	std::string shader_cache_directory = "shader_cache";
+
+	// the log files below are written in this directory, created on init,
+	// unless their path is absolute
+	std::string log_directory = "logs";
+
+	// every log record is also appended here in binary form (see vroum_logdecode), empty to disable
+	std::string binary_log_path = "";
+
+	// the last events of every thread are dumped here on VV_FATAL or a crash, empty to disable
+	std::string flight_recorder_path = "flight_recorder.vvlog";
+
+	// lowest level kept by the flight recorder, even when the sinks don't print it.
+	// Below info every VV_DEBUG is formatted into the rings, in release builds too
+	LogLevel flight_recorder_level = LogLevel::info;
+
+	// with VROUM_PROFILER, the first frames are captured as a Chrome trace, 0 to disable
+	u32 profile_capture_frames = 0;
+	std::string profile_capture_path = "profile.json";
+
+	// times the render commands on the GPU with timestamp queries, the zones
+	// join the profile captures on a "gpu" track
+	bool gpu_profiling = true;
+
+	// frames kept by the frame stats, and how many of the last ones the overlay summarizes
+	u32 frame_stats_history = 600;
+	u32 stats_overlay_window = 120;
+
+	// the overlay is toggled with this key, 0 for none
+	bool show_stats_overlay = false;
+	SDL_Keycode stats_overlay_key = SDLK_F3;
+
+	// the kept frames are written here as CSV on shutdown, empty to disable
+	std::string frame_stats_csv_path = "";
+
+	// renders into a window_width x window_height framebuffer object through
+	// SDL's offscreen video driver, for headless servers without a display.
+	// Nothing is shown and frames are not vsynced, see RenderingSystem::capture_frame
+	bool offscreen = false;
+
+	// dedicated server: no window, GL context nor render thread. Layers run
+	// at server_tick_rate with a fixed dt, their RenderingSystem is null and
+	// the tasks writing resources::command_list are skipped
+	bool server = false;
+	u32 server_tick_rate = 60;
+
+	// a server starts the flight recorder, FlightRecorder::ring_capacity
+	// events per thread, only when this is set
+	bool server_flight_recorder = false;
 };
 
 class Engine
@@ -37,7 +129,7 @@ public:
 	{
 		auto layer_ptr = std::make_unique<LayerType>();
 		layer_ptr->m_app = this;
-		layer_ptr->m_rend = &m_graphics_sys;
+		layer_ptr->m_rend = m_graphics_sys.get();
 
 		if( layer_ptr->init() != Error::ok )
 		{
@@ -50,6 +142,42 @@ public:
 
 	void run();
 
+	// run() returns at the end of the current frame
+	void quit() { m_running = false; }
+
+	// Spreads work over every core, jobs can be submitted from the game thread
+	// (layers' update and render) and from other jobs
+	JobSystem &jobs() { return m_jobs; }
+
+	// Scratch memory rewound at the start of every frame, usable from any job
+	FrameArena &frame_arena() { return m_frame_arena; }
+
+	// Timings and critical path of the last frame's task graph
+	const FrameTaskProfile &frame_task_profile() const { return m_task_graph.last_profile(); }
+
+	// Captures the profiler zones of the next `frame_count` frames to
+	// EngineParameters::profile_capture_path, needs VROUM_PROFILER
+	void capture_profile( u32 frame_count );
+
+	// Times and counters of the last EngineParameters::frame_stats_history frames.
+	// The render thread ones lag a frame behind, the GPU ones a few more
+	const FrameStats &frame_stats() const { return m_frame_stats; }
+
+	bool is_server() const { return m_params.server; }
+
+	// Time between two Layer::fixed_update() calls, 0 without fixed ticks
+	double fixed_dt() const { return static_cast<double>(m_fixed_step_ns) * 1e-9; }
+
+	// Where the current frame sits between the last fixed tick (0) and the next one (1),
+	// render() blends the last two simulation states with it
+	double interpolation_alpha() const { return m_interpolation_alpha; }
+
+	// The window is inactive, frames are throttled and not rendered, see EngineParameters::idle_tick_rate
+	bool is_idle() const { return m_idle; }
+
+	void show_stats_overlay( bool show ) { m_stats_overlay_visible = show; }
+	bool stats_overlay_visible() const { return m_stats_overlay_visible; }
+
 private:
 	bool init_window();
 
@@ -57,12 +185,52 @@ private:
 
 	void dispatch_events();
 
+	// Idles or wakes up the engine after the window changed state, and once at init
+	void update_idle_state();
+
+	// Events, the fixed ticks due and the layers' frame graph for `elapsed_ns`
+	// nanoseconds of game time, timed in `sample`
+	void update_layers( u64 elapsed_ns, FrameSample &sample );
+
+	// Accumulates `elapsed_ns` and runs the Layer::fixed_update() steps it covers
+	void step_fixed_updates( u64 elapsed_ns );
+
+	// run() of a server, one tick per TickScheduler period
+	void run_server();
+
+	void check_frame_allocations( u64 frame_index );
+
+	// `path` in EngineParameters::log_directory, creating the directory
+	std::string log_file_path( const std::string &path ) const;
+
+	// Starts and stops the requested profile capture, between two frames
+	void update_profile_capture();
+
+	// Records the summary of the last frames for the render thread to draw
+	void draw_stats_overlay();
+
+	// Fills in what the render thread measured and keeps the sample
+	void push_frame_stats( FrameSample &sample );
+
 private:
-	RenderingSystem m_graphics_sys;
+	std::unique_ptr<RenderingSystem> m_graphics_sys; // null on a server
+	JobSystem m_jobs;
+	FrameTaskGraph m_task_graph;
+	FrameArena m_frame_arena;
 	EngineParameters m_params;
 	SDL_Window *m_window = nullptr;
 	std::vector<std::unique_ptr<Layer>> m_layers;
 	bool m_running = true;
+	u32 m_profile_frames_left = 0;
+	FrameStats m_frame_stats;
+	FramePacer m_pacer;
+	bool m_stats_overlay_visible = false;
+	bool m_idle = false;
+
+	u64 m_fixed_step_ns = 0;
+	u64 m_fixed_accumulator_ns = 0;
+	u64 m_dropped_fixed_steps = 0;
+	double m_interpolation_alpha = 0.0;
 };
 
 } // namespace vv
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "command_list.hpp"
+
+#include <cstring>
+
+using namespace vv;
+
+const char *CommandList::copy_string( const char *str, std::size_t length )
+{
+	char *copy = static_cast<char*>(allocate(length + 1, 1));
+	std::memcpy(copy, str, length);
+	copy[length] = '\0';
+	return copy;
+}
+
+void CommandList::upload_buffer( u32 target, u32 buffer, u64 offset, const void *data, u64 size )
+{
+	void *copy = allocate(size);
+	std::memcpy(copy, data, size);
+
+	UploadBufferCmd cmd;
+	cmd.target = target;
+	cmd.buffer = buffer;
+	cmd.offset = offset;
+	cmd.size = size;
+	cmd.data = copy;
+	push(cmd);
+}
+
+void CommandList::flush_draws()
+{
+	u32 pending = static_cast<u32>(m_draw_items.size()) - m_flushed_draws;
+	if( pending == 0 )
+		return;
+
+	DrawBucketCmd cmd;
+	cmd.list = this;
+	cmd.first = m_flushed_draws;
+	cmd.count = pending;
+	push(cmd);
+
+	m_flushed_draws += pending;
+}
+
+void CommandList::reset()
+{
+	m_commands.clear();
+	m_draw_items.clear();
+	m_flushed_draws = 0;
+	m_arena.reset();
+}
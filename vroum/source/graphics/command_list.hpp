@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "render_cmd.hpp"
+#include "draw_item.hpp"
+#include "memory/linear_arena.hpp"
+
+#include <string>
+#include <vector>
+
+namespace vv
+{
+
+// Commands recorded by the layers during one frame. The storage is kept
+// between frames, so once it reached its steady-state size recording a
+// command is a plain write at the end of a linear buffer.
+// Data too big for a RenderCmd (uploads...) is copied in the list arena.
+class CommandList
+{
+public:
+	CommandList() = default;
+
+	CommandList(const CommandList &) = delete;
+	CommandList &operator=(const CommandList &) = delete;
+
+	void push( const RenderCmd &cmd ) { m_commands.push_back(cmd); }
+
+	// Memory owned by the list until the next reset
+	void *allocate( std::size_t size, std::size_t alignment = 16 ) { return m_arena.allocate(size, alignment); }
+
+	LinearArena &arena() { return m_arena; }
+
+	// Null terminated copy owned by the list until the next reset
+	const char *copy_string( const std::string &str ) { return copy_string(str.c_str(), str.size()); }
+	const char *copy_string( const char *str, std::size_t length );
+
+	// Copies `data` in the list arena and records the upload
+	void upload_buffer( u32 target, u32 buffer, u64 offset, const void *data, u64 size );
+
+	// Draw items are buffered until the next flush, then sorted on their key
+	void submit_draw( const DrawItem &item ) { m_draw_items.push_back(item); }
+
+	// Records a bucket with every draw submitted since the previous flush,
+	// commands recorded after it execute after those draws
+	void flush_draws();
+
+	const DrawItem *draw_items() const { return m_draw_items.data(); }
+
+	// Forget every command but keep the memory for the next frame
+	void reset();
+
+	bool empty() const { return m_commands.empty(); }
+	std::size_t size() const { return m_commands.size(); }
+
+	auto begin() const { return m_commands.begin(); }
+	auto end() const { return m_commands.end(); }
+
+private:
+	std::vector<RenderCmd> m_commands;
+	std::vector<DrawItem> m_draw_items;
+	u32 m_flushed_draws = 0;
+	LinearArena m_arena;
+};
+
+} // namespace vv
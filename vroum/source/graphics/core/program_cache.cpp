@@ -0,0 +1,201 @@
+#include "program_cache.hpp"
+
+#include <glad/glad.h>
+#include <SDL3/SDL.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace vv;
+
+namespace
+{
+
+constexpr u32 cache_magic = 0x42505656; // "VVPB"
+constexpr u32 cache_version = 1;
+
+struct CacheHeader
+{
+	u32 magic;
+	u32 version;
+	u64 key;
+	u32 format;
+	u32 length;
+};
+
+u64 fnv1a( u64 hash, const std::string &str )
+{
+	for(unsigned char c: str)
+		hash = (hash ^ c) * 1099511628211ull;
+
+	// separator, so that {"ab", "c"} and {"a", "bc"} differ
+	return (hash ^ 0xff) * 1099511628211ull;
+}
+
+const char *gl_string( GLenum name )
+{
+	const GLubyte *str = glGetString(name);
+	return str ? reinterpret_cast<const char*>(str) : "";
+}
+
+} // namespace
+
+void ProgramBinaryCache::set_directory( const std::string &directory )
+{
+	m_directory = directory;
+
+	if( m_directory.empty() )
+		return;
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	if( error )
+	{
+		VV_WARN("Cannot create the shader cache directory", m_directory, error.message());
+		m_directory.clear();
+	}
+}
+
+bool ProgramBinaryCache::supported()
+{
+	if( m_checked )
+		return m_supported;
+
+	m_checked = true;
+
+	// core in 4.1, glad only loads them when the context reports 4.1+
+	// but drivers also expose them through ARB_get_program_binary
+	if( !glad_glGetProgramBinary )
+		glad_glGetProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(SDL_GL_GetProcAddress("glGetProgramBinary"));
+	if( !glad_glProgramBinary )
+		glad_glProgramBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(SDL_GL_GetProcAddress("glProgramBinary"));
+	if( !glad_glProgramParameteri )
+		glad_glProgramParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(SDL_GL_GetProcAddress("glProgramParameteri"));
+
+	int format_count = 0;
+	if( glad_glGetProgramBinary && glad_glProgramBinary && glad_glProgramParameteri )
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+	m_supported = format_count > 0;
+	m_driver_id = std::string(gl_string(GL_VENDOR)) + '|' + gl_string(GL_RENDERER) + '|' + gl_string(GL_VERSION);
+
+	if( !m_supported )
+		VV_INFO("Program binaries are not supported by the driver, shader cache disabled");
+
+	return m_supported;
+}
+
+u64 ProgramBinaryCache::make_key( const std::vector<std::string> &sources, const std::vector<std::string> &defines )
+{
+	supported(); // fills the driver id
+
+	u64 hash = 14695981039346656037ull;
+	hash = fnv1a(hash, m_driver_id);
+
+	for(const std::string &source: sources)
+		hash = fnv1a(hash, source);
+
+	for(const std::string &define: defines)
+		hash = fnv1a(hash, define);
+
+	return hash;
+}
+
+std::string ProgramBinaryCache::entry_path( u64 key ) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(m_directory) / name).string();
+}
+
+void ProgramBinaryCache::prepare_for_link( u32 program )
+{
+	if( !m_directory.empty() && supported() )
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramBinaryCache::load( u32 program, u64 key )
+{
+	if( m_directory.empty() || !supported() )
+		return false;
+
+	std::string path = entry_path(key);
+	std::ifstream file(path, std::ios::binary);
+	if( !file )
+		return false;
+
+	std::vector<char> content{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	file.close();
+
+	CacheHeader header;
+	bool well_formed = content.size() >= sizeof(CacheHeader);
+	if( well_formed )
+	{
+		std::memcpy(&header, content.data(), sizeof(CacheHeader));
+		well_formed = header.magic == cache_magic && header.version == cache_version && header.key == key
+			&& header.length == content.size() - sizeof(CacheHeader);
+	}
+
+	if( !well_formed )
+	{
+		VV_WARN("Corrupted shader cache entry, ignoring it:", path);
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		return false;
+	}
+
+	glProgramBinary(program, header.format, content.data() + sizeof(CacheHeader), header.length);
+
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if( !success )
+	{
+		// the driver changed in a way the key does not see, rebuild it from source
+		VV_WARN("The driver rejected a cached program binary, recompiling:", path);
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		return false;
+	}
+
+	return true;
+}
+
+void ProgramBinaryCache::store( u32 program, u64 key )
+{
+	if( m_directory.empty() || !supported() )
+		return;
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if( length <= 0 )
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	CacheHeader header { cache_magic, cache_version, key, format, static_cast<u32>(length) };
+
+	// write next to the entry then rename, a crash never leaves half a file behind
+	std::string path = entry_path(key);
+	std::string tmp_path = path + ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if( !file )
+		{
+			VV_WARN("Cannot write shader cache entry", tmp_path);
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), length);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmp_path, path, error);
+	if( error )
+		VV_WARN("Cannot write shader cache entry", path, error.message());
+}
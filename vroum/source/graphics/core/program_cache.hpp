@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+#include <string>
+#include <vector>
+
+namespace vv
+{
+
+// On-disk cache of linked GL programs (glGetProgramBinary / glProgramBinary).
+// Entries are keyed on the shader sources, the defines and the driver
+// vendor / renderer / version, so a driver update simply misses the cache.
+// Must only be used from the thread owning the GL context.
+class ProgramBinaryCache
+{
+public:
+	ProgramBinaryCache(const ProgramBinaryCache&)            = delete;
+	ProgramBinaryCache &operator=(const ProgramBinaryCache&) = delete;
+
+	inline static ProgramBinaryCache &get()
+	{
+		static ProgramBinaryCache instance;
+		return instance;
+	}
+
+	// An empty directory disables the cache
+	void set_directory( const std::string &directory );
+
+	// False when the driver exposes no binary format
+	bool supported();
+
+	u64 make_key( const std::vector<std::string> &sources, const std::vector<std::string> &defines );
+
+	// Loads the binary in `program`, false on a miss or if the driver rejects it
+	bool load( u32 program, u64 key );
+
+	// To call on a freshly linked program
+	void store( u32 program, u64 key );
+
+	// Must be set before linking for the driver to keep the binary around
+	void prepare_for_link( u32 program );
+
+private:
+	ProgramBinaryCache() {}
+
+	std::string entry_path( u64 key ) const;
+
+	std::string m_directory;
+	std::string m_driver_id;
+	bool m_checked = false;
+	bool m_supported = false;
+};
+
+} // namespace vv
@@ -1,66 +1,212 @@
 #include "shader.hpp"
+#include "program_cache.hpp"
+#include "graphics/gl_state_cache.hpp"
 
 // #include "cmake_defines.hpp"
 // #include "gldebug.hpp"
 // #include "core/logger.hpp"
 
 #include <glad/glad.h>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+	#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iterator>
 
-vv::Shader::Shader(const std::string& vs_path, const std::string &fs_path) {
-	m_is_valid = true;
-	vv::u32 vs = 0, fs = 0;
+vv::Shader::Shader(const std::string& vs_path, const std::string &fs_path, const std::vector<std::string> &defines, ShaderLoad mode) {
+	m_load_start = std::chrono::steady_clock::now();
+	m_name = vs_path + " " + fs_path;
+
+	// read sources
+	std::string vs_source, fs_source;
+	bool sources_ok = true;
+
+	if (vs_path != "" && !read_source(vs_path, defines, vs_source))
+		sources_ok = false;
+
+	if (fs_path != "" && !read_source(fs_path, defines, fs_source))
+		sources_ok = false;
+
+	begin_load(vs_source, fs_source, defines, sources_ok);
+
+	if (mode == ShaderLoad::blocking)
+		poll(false);
+}
+
+std::unique_ptr<vv::Shader> vv::Shader::from_source(const std::string &vs_source, const std::string &fs_source,
+	const std::string &name, ShaderLoad mode) {
+	std::unique_ptr<Shader> shader(new Shader());
+	shader->m_load_start = std::chrono::steady_clock::now();
+	shader->m_name = name;
+
+	shader->begin_load(vs_source, fs_source, {}, true);
+
+	if (mode == ShaderLoad::blocking)
+		shader->poll(false);
+
+	return shader;
+}
+
+void vv::Shader::begin_load(const std::string &vs_source, const std::string &fs_source, const std::vector<std::string> &defines, bool sources_ok) {
+	m_id = glCreateProgram();
+	m_is_valid = false;
+
+	if (!sources_ok) {
+		m_state = ShaderState::failed;
+		return;
+	}
 
-	// compiles shaders
-	if (vs_path != "")
-		vs = compile_shader(vs_path, GL_VERTEX_SHADER);
+	// warm start: the driver gives back the program it linked last time
+	auto &cache = ProgramBinaryCache::get();
+	m_cache_key = cache.make_key({ vs_source, fs_source }, defines);
 
-	if (fs_path != "")
-		fs = compile_shader(fs_path, GL_FRAGMENT_SHADER);
+	if (cache.load(m_id, m_cache_key)) {
+		m_is_valid = true;
+		m_state = ShaderState::ready;
+		reflect();
 
-	// create program and link shaders
+		double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_load_start).count();
+		VV_INFO("Shader loaded from the binary cache (warm) in", load_ms, "ms:", m_name);
+		return;
+	}
+
+	// a rejected binary leaves the program unusable, start from a new one
+	glDeleteProgram(m_id);
 	m_id = glCreateProgram();
 
-	if (vs)
-		glAttachShader(m_id, vs);
+	// queue everything without asking for any status, a status query waits for the driver
+	if (vs_source != "")
+		m_vs = compile_shader(vs_source, GL_VERTEX_SHADER);
 
-	if (fs)
-		glAttachShader(m_id, fs);
+	if (fs_source != "")
+		m_fs = compile_shader(fs_source, GL_FRAGMENT_SHADER);
 
+	if (m_vs)
+		glAttachShader(m_id, m_vs);
+
+	if (m_fs)
+		glAttachShader(m_id, m_fs);
+
+	cache.prepare_for_link(m_id);
 	glLinkProgram(m_id);
 
+	m_state = ShaderState::compiling;
+}
+
+vv::ShaderState vv::Shader::poll(bool query_completion) {
+	if (m_state != ShaderState::compiling)
+		return m_state;
+
+	if (query_completion) {
+		int done = 0;
+		glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done)
+			return m_state;
+	}
+
+	finish_load();
+	return m_state;
+}
+
+void vv::Shader::finish_load() {
+	// compile errors are more useful than the link error they cause
+	bool compiled = true;
+	if (m_vs)
+		compiled = check_shader(m_vs) && compiled;
+	if (m_fs)
+		compiled = check_shader(m_fs) && compiled;
+
 	// error handling
 	int success;
 	glGetProgramiv(m_id, GL_LINK_STATUS, &success);
-	if (!success) {
+	if (!success && compiled) {
 		char info[512];
 		glGetProgramInfoLog(m_id, 512, nullptr, info);
 		VV_ERROR("Can't link shader: ", info);
-		m_is_valid = false;
+	}
+
+	m_is_valid = success && compiled;
+	m_state = m_is_valid ? ShaderState::ready : ShaderState::failed;
+
+	if (m_is_valid) {
+		reflect();
+		ProgramBinaryCache::get().store(m_id, m_cache_key);
 	}
 
 	// cleaning
-	if (vs)
-		glDeleteShader(vs);
-	if (fs)
-		glDeleteShader(fs);
+	if (m_vs)
+		glDeleteShader(m_vs);
+	if (m_fs)
+		glDeleteShader(m_fs);
+	m_vs = m_fs = 0;
 
+	if (m_is_valid) {
+		double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_load_start).count();
+		VV_INFO("Shader compiled from source (cold) in", load_ms, "ms:", m_name);
+	}
+}
+
+bool vv::Shader::read_source(const std::string &path, const std::vector<std::string> &defines, std::string &source) {
+	std::fstream file{ path, std::ios::in };
+
+	if(!file) {
+		VV_ERROR("Failed to open shader: ", path, "\n");
+		return false;
+	}
+
+	file >> std::noskipws;
+	source.assign(std::istream_iterator<char>(file), std::istream_iterator<char>());
+
+	if (defines.empty())
+		return true;
+
+	// defines go right after the #version line, which has to stay first
+	std::string define_block;
+	for (const std::string &define: defines)
+		define_block += "#define " + define + "\n";
+
+	std::size_t insert_at = 0;
+	std::size_t version = source.find("#version");
+	if (version != std::string::npos) {
+		std::size_t line_end = source.find('\n', version);
+		insert_at = line_end == std::string::npos ? source.size() : line_end + 1;
+		if (line_end == std::string::npos)
+			define_block.insert(0, "\n");
+	}
+
+	source.insert(insert_at, define_block);
+	return true;
 }
 
 vv::Shader::~Shader() {
+	if (m_vs)
+		glDeleteShader(m_vs);
+	if (m_fs)
+		glDeleteShader(m_fs);
+
+	if (auto *state = vv::GLStateCache::current())
+		state->on_program_deleted(m_id);
 	glDeleteProgram(m_id);
 }
 
 void vv::Shader::bind() {
 	if (!m_is_valid)
 		throw std::runtime_error("Can't use a unvalid shader");
+	else if (auto *state = vv::GLStateCache::current())
+		state->use_program(m_id);
 	else
 		glUseProgram(m_id);
 }
 
 void vv::Shader::unbind() {
-	glUseProgram(0);
+	if (auto *state = vv::GLStateCache::current())
+		state->use_program(0);
+	else
+		glUseProgram(0);
 }
 
 void vv::Shader::set_int(const std::string& name, int value) {
@@ -87,36 +233,162 @@ void vv::Shader::set_mat4(const std::string& name, float* matrix) {
 	glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, matrix);
 }
 
-vv::u32 vv::Shader::compile_shader(const std::string& path, vv::u32 type) {
+void vv::Shader::set(Uniform<int> uniform, int value) {
+	glUniform1i(uniform.location, value);
+}
+
+void vv::Shader::set(Uniform<float> uniform, float value) {
+	glUniform1f(uniform.location, value);
+}
 
-	std::fstream file{ path, std::ios::in };
+void vv::Shader::set(Uniform<glm::vec2> uniform, const glm::vec2 &value) {
+	glUniform2fv(uniform.location, 1, glm::value_ptr(value));
+}
 
-	if(!file) {
-		VV_ERROR("Failed to open shader: ", path, "\n");
-		return 0;
+void vv::Shader::set(Uniform<glm::vec3> uniform, const glm::vec3 &value) {
+	glUniform3fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void vv::Shader::set(Uniform<glm::vec4> uniform, const glm::vec4 &value) {
+	glUniform4fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void vv::Shader::set(Uniform<glm::mat3> uniform, const glm::mat3 &value) {
+	glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void vv::Shader::set(Uniform<glm::mat4> uniform, const glm::mat4 &value) {
+	glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+vv::i32 vv::Shader::uniform_block(u32 name_hash) const {
+	auto it = std::lower_bound(m_uniform_blocks.begin(), m_uniform_blocks.end(), name_hash,
+		[](const UniformBlockInfo &block, u32 hash) { return block.hash < hash; });
+
+	if (it == m_uniform_blocks.end() || it->hash != name_hash)
+		return -1;
+
+	return it->index;
+}
+
+void vv::Shader::bind_uniform_block(u32 name_hash, u32 binding) {
+	i32 index = uniform_block(name_hash);
+	if (index >= 0)
+		glUniformBlockBinding(m_id, static_cast<GLuint>(index), binding);
+}
+
+static bool is_compatible(vv::UniformType type, GLenum gl_type) {
+	switch (type) {
+	case vv::UniformType::int_:
+		// samplers are set with an int too
+		return gl_type == GL_INT || gl_type == GL_BOOL
+			|| gl_type == GL_SAMPLER_2D || gl_type == GL_SAMPLER_3D || gl_type == GL_SAMPLER_CUBE
+			|| gl_type == GL_SAMPLER_2D_ARRAY || gl_type == GL_SAMPLER_2D_SHADOW;
+	case vv::UniformType::float_: return gl_type == GL_FLOAT;
+	case vv::UniformType::vec2:   return gl_type == GL_FLOAT_VEC2;
+	case vv::UniformType::vec3:   return gl_type == GL_FLOAT_VEC3;
+	case vv::UniformType::vec4:   return gl_type == GL_FLOAT_VEC4;
+	case vv::UniformType::mat3:   return gl_type == GL_FLOAT_MAT3;
+	case vv::UniformType::mat4:   return gl_type == GL_FLOAT_MAT4;
+	default:                      return false;
 	}
+}
 
-	file << std::noskipws;
-	std::string source{ std::istream_iterator<char>(file), std::istream_iterator<char>() };
+vv::i32 vv::Shader::find_location(u32 name_hash, UniformType type) const {
+	auto it = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), name_hash,
+		[](const UniformInfo &uniform, u32 hash) { return uniform.hash < hash; });
 
-	auto c_str_source = source.c_str();
+	if (it == m_uniforms.end() || it->hash != name_hash)
+		return -1;
+
+	if (!is_compatible(type, it->gl_type)) {
+		VV_ERROR("Uniform type mismatch, location", it->location);
+		return -1;
+	}
+
+	return it->location;
+}
 
-	file.close();
+void vv::Shader::reflect() {
+	m_uniforms.clear();
+	m_uniform_blocks.clear();
+
+	// plain uniforms: the ones living in a block have no location
+	int uniform_count = 0, max_name_length = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniform_count);
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+	std::string name(std::max(max_name_length, 1), '\0');
+
+	for (int i = 0; i < uniform_count; ++i) {
+		GLsizei length = 0;
+		GLint count = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_id, i, max_name_length, &length, &count, &type, &name[0]);
+
+		std::string uniform_name = name.substr(0, length);
+		GLint location = glGetUniformLocation(m_id, uniform_name.c_str());
+		if (location < 0)
+			continue;
+
+		// arrays are reported as "name[0]", look them up as "name"
+		if (uniform_name.size() > 3 && uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0)
+			uniform_name.resize(uniform_name.size() - 3);
+
+		m_uniforms.push_back(UniformInfo{ uniform_hash(uniform_name.c_str()), location, type, count });
+	}
+
+	// uniform blocks
+	int block_count = 0, max_block_name_length = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_block_name_length);
+
+	name.assign(std::max(max_block_name_length, 1), '\0');
+
+	for (int i = 0; i < block_count; ++i) {
+		GLsizei length = 0;
+		GLint data_size = 0;
+		glGetActiveUniformBlockName(m_id, i, max_block_name_length, &length, &name[0]);
+		glGetActiveUniformBlockiv(m_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+
+		m_uniform_blocks.push_back(UniformBlockInfo{ uniform_hash(name.substr(0, length).c_str()), i, data_size });
+	}
+
+	auto by_hash = [](const auto &a, const auto &b) { return a.hash < b.hash; };
+	std::sort(m_uniforms.begin(), m_uniforms.end(), by_hash);
+	std::sort(m_uniform_blocks.begin(), m_uniform_blocks.end(), by_hash);
+
+	// two names with the same hash would silently alias each other
+	auto same_hash = [](const auto &a, const auto &b) { return a.hash == b.hash; };
+	if (std::adjacent_find(m_uniforms.begin(), m_uniforms.end(), same_hash) != m_uniforms.end()
+		|| std::adjacent_find(m_uniform_blocks.begin(), m_uniform_blocks.end(), same_hash) != m_uniform_blocks.end()) {
+		VV_ERROR("Uniform name hash collision in program", m_id);
+	}
+}
+
+vv::u32 vv::Shader::compile_shader(const std::string& source, vv::u32 type) {
+
+	auto c_str_source = source.c_str();
 
 	vv::u32 shader = glCreateShader(type);
 	glShaderSource(shader, 1, &c_str_source, nullptr);
 	glCompileShader(shader);
 
+	return shader;
+
+}
+
+bool vv::Shader::check_shader(vv::u32 shader) {
+
 	int success;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (!success) {
 		char infos[512];
 		glGetShaderInfoLog(shader, 512, nullptr, infos);
-		VV_ERROR("Failed to compile shader : ", infos);
-		m_is_valid = false;
-		return 0;
+		VV_ERROR("Failed to compile shader : ", m_name, infos);
+		return false;
 	}
 
-	return shader;
+	return true;
 
 }
\ No newline at end of file
@@ -1,16 +1,70 @@
 #pragma once
 
 #include "vv_headers.hpp"
+#include <glm/glm.hpp>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace vv
 {
 
+// FNV-1a, usable at compile time: constexpr u32 u_model = uniform_hash("u_model");
+constexpr u32 uniform_hash(const char *name) {
+	u32 hash = 2166136261u;
+	while (*name)
+		hash = (hash ^ static_cast<u8>(*name++)) * 16777619u;
+	return hash;
+}
+
+enum class UniformType : u8 {
+	int_, float_, vec2, vec3, vec4, mat3, mat4
+};
+
+template <typename T> struct UniformTypeOf;
+template <> struct UniformTypeOf<int>       { static constexpr UniformType value = UniformType::int_; };
+template <> struct UniformTypeOf<float>     { static constexpr UniformType value = UniformType::float_; };
+template <> struct UniformTypeOf<glm::vec2> { static constexpr UniformType value = UniformType::vec2; };
+template <> struct UniformTypeOf<glm::vec3> { static constexpr UniformType value = UniformType::vec3; };
+template <> struct UniformTypeOf<glm::vec4> { static constexpr UniformType value = UniformType::vec4; };
+template <> struct UniformTypeOf<glm::mat3> { static constexpr UniformType value = UniformType::mat3; };
+template <> struct UniformTypeOf<glm::mat4> { static constexpr UniformType value = UniformType::mat4; };
+
+// Location of a uniform resolved once, setting it is a single glUniform call
+template <typename T>
+struct Uniform {
+	i32 location = -1;
+
+	bool valid() const { return location >= 0; }
+};
+
+enum class ShaderState : u8 {
+	compiling, ready, failed
+};
+
+enum class ShaderLoad : u8 {
+	blocking, // compiled and linked when the constructor returns
+	async     // compile and link are queued, poll() until the shader leaves `compiling`
+};
+
 class Shader {
 public:
-	Shader(const std::string& vs_path, const std::string& fs_path);
+	// `defines` are injected after the #version line, "NAME" or "NAME value"
+	Shader(const std::string& vs_path, const std::string& fs_path, const std::vector<std::string> &defines = {},
+		ShaderLoad mode = ShaderLoad::blocking);
 	~Shader();
 
+	// Shader built from in-memory sources, `name` is only used in the logs
+	static std::unique_ptr<Shader> from_source(const std::string &vs_source, const std::string &fs_source,
+		const std::string &name, ShaderLoad mode = ShaderLoad::blocking);
+
+	// Finishes an async load once the driver is done. With `query_completion`
+	// (KHR_parallel_shader_compile) it never blocks, otherwise it waits for the driver
+	ShaderState poll(bool query_completion);
+
+	ShaderState state() const { return m_state; }
+
 	void bind();
 	void unbind();
 
@@ -23,11 +77,72 @@ public:
 	void set_vec4( const std::string& name, float x, float y, float z, float w);
 	void set_mat4( const std::string& name, float* matrix );
 
+	// Typed handles, looked up in the table reflected after linking.
+	// The handle is invalid when the uniform is missing or has another type
+	template <typename T>
+	Uniform<T> uniform(u32 name_hash) const { return Uniform<T>{ find_location(name_hash, UniformTypeOf<T>::value) }; }
+
+	template <typename T>
+	Uniform<T> uniform(const char *name) const { return uniform<T>(uniform_hash(name)); }
+
+	// Fast path, the program must be bound
+	void set(Uniform<int> uniform, int value);
+	void set(Uniform<float> uniform, float value);
+	void set(Uniform<glm::vec2> uniform, const glm::vec2 &value);
+	void set(Uniform<glm::vec3> uniform, const glm::vec3 &value);
+	void set(Uniform<glm::vec4> uniform, const glm::vec4 &value);
+	void set(Uniform<glm::mat3> uniform, const glm::mat3 &value);
+	void set(Uniform<glm::mat4> uniform, const glm::mat4 &value);
+
+	// Index of an active uniform block, -1 if there is none with this name
+	i32 uniform_block(u32 name_hash) const;
+	void bind_uniform_block(u32 name_hash, u32 binding);
+
+	u32 id() const { return m_id; }
+
 private:
-	vv::u32 compile_shader( const std::string &path, vv::u32 type);
+	struct UniformInfo {
+		u32 hash;
+		i32 location;
+		u32 gl_type;
+		i32 count;
+	};
+
+	struct UniformBlockInfo {
+		u32 hash;
+		i32 index;
+		i32 data_size;
+	};
+
+	Shader() = default;
+
+	static bool read_source( const std::string &path, const std::vector<std::string> &defines, std::string &source );
+
+	void begin_load( const std::string &vs_source, const std::string &fs_source, const std::vector<std::string> &defines, bool sources_ok );
 
-	vv::u32 m_id;
+	void finish_load();
+
+	vv::u32 compile_shader( const std::string &source, vv::u32 type);
+
+	bool check_shader( vv::u32 shader );
+
+	void reflect();
+
+	i32 find_location(u32 name_hash, UniformType type) const;
+
+	vv::u32 m_id = 0;
 	bool m_is_valid = false;
+	ShaderState m_state = ShaderState::failed;
+
+	// in flight while compiling
+	vv::u32 m_vs = 0, m_fs = 0;
+	u64 m_cache_key = 0;
+	std::string m_name;
+	std::chrono::steady_clock::time_point m_load_start;
+
+	// sorted on the name hash
+	std::vector<UniformInfo> m_uniforms;
+	std::vector<UniformBlockInfo> m_uniform_blocks;
 };
 
 } // namespace vv
\ No newline at end of file
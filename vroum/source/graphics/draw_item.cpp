@@ -0,0 +1,55 @@
+#include "draw_item.hpp"
+
+#include <cstring>
+#include <utility>
+
+void vv::radix_sort( DrawSortEntry *entries, DrawSortEntry *scratch, std::size_t count )
+{
+	constexpr u32 radix = 256;
+	constexpr u32 passes = 8;
+
+	if( count < 2 )
+		return;
+
+	// every histogram in a single read of the keys
+	u32 histograms[passes][radix] = {};
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		u64 key = entries[i].key;
+		for(u32 pass = 0; pass < passes; ++pass)
+			++histograms[pass][(key >> (pass * 8)) & 0xff];
+	}
+
+	DrawSortEntry *src = entries;
+	DrawSortEntry *dst = scratch;
+
+	for(u32 pass = 0; pass < passes; ++pass)
+	{
+		u32 *histogram = histograms[pass];
+
+		// every key shares this digit, nothing to reorder
+		u32 digit = (entries[0].key >> (pass * 8)) & 0xff;
+		if( histogram[digit] == count )
+			continue;
+
+		// exclusive prefix sum gives the first output slot of every digit
+		u32 offset = 0;
+		for(u32 d = 0; d < radix; ++d)
+		{
+			u32 n = histogram[d];
+			histogram[d] = offset;
+			offset += n;
+		}
+
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			u32 d = (src[i].key >> (pass * 8)) & 0xff;
+			dst[histogram[d]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+
+	if( src != entries )
+		std::memcpy(entries, src, count * sizeof(DrawSortEntry));
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "render_cmd.hpp"
+
+#include <algorithm>
+
+namespace vv
+{
+
+enum class DrawPass: u8
+{
+	opaque = 0,
+	translucent = 1
+};
+
+// Everything needed to issue one draw call. Items are sorted on their key
+// before execution, so submission order does not matter.
+struct DrawItem
+{
+	u64 key = 0;
+
+	ShaderHandle shader = 0;
+	u32 vao = 0;
+	u32 texture = 0; // bound to GL_TEXTURE_2D, unit 0
+
+	u32 mode = 0;        // GL_TRIANGLES...
+	u32 index_type = 0;  // 0 for non indexed draws
+	i32 count = 0;
+	i32 first = 0;       // first vertex, or base vertex for indexed draws
+	u64 index_offset = 0;
+	i32 instance_count = 1;
+};
+
+// 64 bits draw sort key, from the most to the least significant bits:
+//
+//   opaque:      | layer:8 | pass:1 | shader:12 | material:16 | depth:27       |
+//   translucent: | layer:8 | pass:1 | inverted depth:27 | shader:12 | material:16 |
+//
+// Layers (views) are drawn in order, opaque before translucent. Opaque draws
+// are grouped by shader then material to minimize state changes, and go front
+// to back inside a group. Translucent draws go back to front for blending.
+namespace draw_key
+{
+	constexpr u32 layer_bits = 8;
+	constexpr u32 shader_bits = 12;
+	constexpr u32 material_bits = 16;
+	constexpr u32 depth_bits = 27;
+
+	constexpr u64 mask( u32 bits ) { return (u64(1) << bits) - 1; }
+
+	constexpr u32 pass_shift = shader_bits + material_bits + depth_bits;
+	constexpr u32 layer_shift = pass_shift + 1;
+
+	static_assert(layer_shift + layer_bits == 64, "draw key must use exactly 64 bits");
+
+	// `depth` is the view depth normalized to [0, 1]. In double: a float
+	// rounds 1.0 * mask(depth_bits) up to 2^27, one bit too many
+	constexpr u64 quantize_depth( float depth )
+	{
+		if( !(depth > 0.0f) ) // NaN too
+			return 0;
+
+		double scaled = std::min(static_cast<double>(depth), 1.0) * static_cast<double>(mask(depth_bits));
+		return std::min(static_cast<u64>(scaled), mask(depth_bits));
+	}
+
+	constexpr u64 make( u32 layer, DrawPass pass, u32 shader, u32 material, float depth )
+	{
+		u64 key = (u64(layer) & mask(layer_bits)) << layer_shift;
+		u64 shader_id = u64(shader) & mask(shader_bits);
+		u64 material_id = u64(material) & mask(material_bits);
+		u64 depth_q = quantize_depth(depth);
+
+		if( pass == DrawPass::opaque )
+		{
+			key |= shader_id << (material_bits + depth_bits);
+			key |= material_id << depth_bits;
+			key |= depth_q;
+		}
+		else
+		{
+			key |= u64(1) << pass_shift;
+			key |= (mask(depth_bits) - depth_q) << (shader_bits + material_bits);
+			key |= shader_id << material_bits;
+			key |= material_id;
+		}
+
+		return key;
+	}
+
+	constexpr DrawPass pass( u64 key )
+	{
+		return static_cast<DrawPass>((key >> pass_shift) & 1);
+	}
+
+	constexpr u32 layer( u64 key )
+	{
+		return static_cast<u32>(key >> layer_shift);
+	}
+
+	// the depth never spills into the neighbouring fields
+	static_assert(quantize_depth(0.0f) == 0 && quantize_depth(1.0f) == mask(depth_bits), "depth out of its field");
+	static_assert(layer(make(3, DrawPass::opaque, 5, 2, 1.0f)) == 3 && pass(make(3, DrawPass::opaque, 5, 2, 1.0f)) == DrawPass::opaque
+		&& ((make(3, DrawPass::opaque, 5, 2, 1.0f) >> depth_bits) & mask(material_bits)) == 2, "opaque depth 1 overflows");
+	static_assert(((make(3, DrawPass::opaque, 5, 2, 0.0f) >> depth_bits) & mask(material_bits)) == 2, "opaque depth 0 overflows");
+	static_assert(layer(make(3, DrawPass::translucent, 5, 2, 1.0f)) == 3 && pass(make(3, DrawPass::translucent, 5, 2, 1.0f)) == DrawPass::translucent
+		&& (make(3, DrawPass::translucent, 5, 2, 1.0f) & mask(material_bits)) == 2, "translucent depth 1 overflows");
+	static_assert(layer(make(3, DrawPass::translucent, 5, 2, 0.0f)) == 3 && pass(make(3, DrawPass::translucent, 5, 2, 0.0f)) == DrawPass::translucent
+		&& (make(3, DrawPass::translucent, 5, 2, 0.0f) & mask(material_bits)) == 2, "translucent depth 0 overflows");
+}
+
+// Entry of the array actually sorted: the key and the item it belongs to
+struct DrawSortEntry
+{
+	u64 key;
+	u32 index;
+};
+
+// Stable LSD radix sort on the 64 bits keys, 8 bits per pass. Passes where
+// every key has the same digit are skipped. `scratch` must hold `count` entries.
+// The result is always written back in `entries`.
+void radix_sort( DrawSortEntry *entries, DrawSortEntry *scratch, std::size_t count );
+
+} // namespace vv
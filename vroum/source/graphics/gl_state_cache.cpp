@@ -0,0 +1,212 @@
+#include "gl_state_cache.hpp"
+
+#include <glad/glad.h>
+
+using namespace vv;
+
+static thread_local GLStateCache *s_current_cache = nullptr;
+
+static u32 texture_target_index( u32 target )
+{
+	switch(target)
+	{
+	case GL_TEXTURE_2D:       return 0;
+	case GL_TEXTURE_CUBE_MAP: return 1;
+	case GL_TEXTURE_2D_ARRAY: return 2;
+	case GL_TEXTURE_3D:       return 3;
+	default:                  return ~0u;
+	}
+}
+
+u32 GLStateStats::total_issued() const
+{
+	u32 total = 0;
+	for(u32 count: issued)
+		total += count;
+	return total;
+}
+
+u32 GLStateStats::total_skipped() const
+{
+	u32 total = 0;
+	for(u32 count: skipped)
+		total += count;
+	return total;
+}
+
+GLStateCache::GLStateCache()
+{
+	invalidate();
+}
+
+GLStateCache *GLStateCache::current()
+{
+	return s_current_cache;
+}
+
+void GLStateCache::make_current()
+{
+	s_current_cache = this;
+}
+
+void GLStateCache::invalidate()
+{
+	m_program = unknown;
+	m_active_texture = unknown;
+	for(auto &unit: m_textures)
+		for(u32 &texture: unit)
+			texture = unknown;
+	m_vertex_array = unknown;
+	m_array_buffer = unknown;
+	m_uniform_buffer = unknown;
+
+	m_blend = unknown;
+	m_blend_src = unknown;
+	m_blend_dst = unknown;
+	m_depth_test = unknown;
+	m_depth_mask = unknown;
+	m_depth_func = unknown;
+	m_cull_face = unknown;
+}
+
+bool GLStateCache::changed( GLStateCall call, u32 &cached, u32 value )
+{
+	u32 index = static_cast<u32>(call);
+
+	if( cached == value )
+	{
+		++m_stats.skipped[index];
+		return false;
+	}
+
+	++m_stats.issued[index];
+	cached = value;
+	return true;
+}
+
+void GLStateCache::set_capability( GLStateCall call, u32 &cached, u32 capability, bool enabled )
+{
+	if( !changed(call, cached, enabled ? 1 : 0) )
+		return;
+
+	if( enabled )
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void GLStateCache::use_program( u32 program )
+{
+	if( changed(GLStateCall::program, m_program, program) )
+		glUseProgram(program);
+}
+
+void GLStateCache::bind_texture( u32 unit, u32 target, u32 texture )
+{
+	u32 target_index = texture_target_index(target);
+
+	if( unit >= max_texture_units || target_index == ~0u )
+	{
+		// not tracked, always send it and forget what we knew about the unit
+		++m_stats.issued[static_cast<u32>(GLStateCall::texture)];
+		m_active_texture = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		if( unit < max_texture_units )
+			for(u32 &bound: m_textures[unit])
+				bound = unknown;
+		return;
+	}
+
+	if( m_textures[unit][target_index] == texture )
+	{
+		++m_stats.skipped[static_cast<u32>(GLStateCall::texture)];
+		return;
+	}
+
+	if( changed(GLStateCall::active_texture, m_active_texture, unit) )
+		glActiveTexture(GL_TEXTURE0 + unit);
+
+	changed(GLStateCall::texture, m_textures[unit][target_index], texture);
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::bind_vertex_array( u32 vao )
+{
+	if( changed(GLStateCall::vertex_array, m_vertex_array, vao) )
+		glBindVertexArray(vao);
+}
+
+void GLStateCache::bind_buffer( u32 target, u32 buffer )
+{
+	// the element array binding belongs to the VAO, only the global bindings are cached
+	u32 *cached = nullptr;
+	if( target == GL_ARRAY_BUFFER )
+		cached = &m_array_buffer;
+	else if( target == GL_UNIFORM_BUFFER )
+		cached = &m_uniform_buffer;
+
+	if( cached == nullptr )
+	{
+		++m_stats.issued[static_cast<u32>(GLStateCall::buffer)];
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if( changed(GLStateCall::buffer, *cached, buffer) )
+		glBindBuffer(target, buffer);
+}
+
+void GLStateCache::set_blend( bool enabled )
+{
+	set_capability(GLStateCall::blend, m_blend, GL_BLEND, enabled);
+}
+
+void GLStateCache::set_blend_func( u32 src, u32 dst )
+{
+	if( m_blend_src == src && m_blend_dst == dst )
+	{
+		++m_stats.skipped[static_cast<u32>(GLStateCall::blend)];
+		return;
+	}
+
+	++m_stats.issued[static_cast<u32>(GLStateCall::blend)];
+	m_blend_src = src;
+	m_blend_dst = dst;
+	glBlendFunc(src, dst);
+}
+
+void GLStateCache::set_depth_test( bool enabled )
+{
+	set_capability(GLStateCall::depth, m_depth_test, GL_DEPTH_TEST, enabled);
+}
+
+void GLStateCache::set_depth_mask( bool enabled )
+{
+	if( changed(GLStateCall::depth, m_depth_mask, enabled ? 1 : 0) )
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::set_depth_func( u32 func )
+{
+	if( changed(GLStateCall::depth, m_depth_func, func) )
+		glDepthFunc(func);
+}
+
+void GLStateCache::set_cull_face( bool enabled )
+{
+	set_capability(GLStateCall::cull, m_cull_face, GL_CULL_FACE, enabled);
+}
+
+void GLStateCache::on_program_deleted( u32 program )
+{
+	if( m_program == program )
+		m_program = unknown;
+}
+
+GLStateStats GLStateCache::end_frame()
+{
+	GLStateStats stats = m_stats;
+	m_stats = GLStateStats();
+	return stats;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+namespace vv
+{
+
+enum class GLStateCall: u8
+{
+	program,
+	active_texture,
+	texture,
+	vertex_array,
+	buffer,
+	blend,
+	depth,
+	cull,
+
+	count
+};
+
+// Calls that reached the driver and calls dropped because they would not
+// have changed anything, per kind of state
+struct GLStateStats
+{
+	u32 issued[static_cast<u32>(GLStateCall::count)] = {};
+	u32 skipped[static_cast<u32>(GLStateCall::count)] = {};
+
+	u32 total_issued() const;
+	u32 total_skipped() const;
+};
+
+// Shadow copy of the GL state owned by the render thread, every bind or
+// state change goes through it and is only sent when the value changes.
+// Code that touches GL directly must call invalidate() afterwards.
+class GLStateCache
+{
+public:
+	static constexpr u32 max_texture_units = 16;
+
+	GLStateCache();
+
+	// The cache used by the calling thread, nullptr outside the render thread
+	static GLStateCache *current();
+	void make_current();
+
+	// Forget everything, the next calls will all be issued
+	void invalidate();
+
+	void use_program( u32 program );
+	void bind_texture( u32 unit, u32 target, u32 texture );
+	void bind_vertex_array( u32 vao );
+	void bind_buffer( u32 target, u32 buffer );
+
+	void set_blend( bool enabled );
+	void set_blend_func( u32 src, u32 dst );
+	void set_depth_test( bool enabled );
+	void set_depth_mask( bool enabled );
+	void set_depth_func( u32 func );
+	void set_cull_face( bool enabled );
+
+	// A deleted name can be handed out again, it must not look bound anymore
+	void on_program_deleted( u32 program );
+
+	// Returns the stats of the frame that just ended and starts a new one
+	GLStateStats end_frame();
+
+	const GLStateStats &frame_stats() const { return m_stats; }
+
+private:
+	static constexpr u32 unknown = ~0u;
+	static constexpr u32 texture_targets = 4;
+
+	bool changed( GLStateCall call, u32 &cached, u32 value );
+	void set_capability( GLStateCall call, u32 &cached, u32 capability, bool enabled );
+
+	u32 m_program;
+	u32 m_active_texture;
+	u32 m_textures[max_texture_units][texture_targets];
+	u32 m_vertex_array;
+	u32 m_array_buffer;
+	u32 m_uniform_buffer;
+
+	u32 m_blend;
+	u32 m_blend_src;
+	u32 m_blend_dst;
+	u32 m_depth_test;
+	u32 m_depth_mask;
+	u32 m_depth_func;
+	u32 m_cull_face;
+
+	GLStateStats m_stats;
+};
+
+} // namespace vv
@@ -0,0 +1,155 @@
+#include "gpu_profiler.hpp"
+#include "profiling/profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+using namespace vv;
+
+bool GpuProfiler::init()
+{
+	m_enabled = false;
+
+	if( !GLAD_GL_VERSION_3_3 )
+	{
+		VV_WARN("GPU profiler disabled: timer queries need OpenGL 3.3");
+		return false;
+	}
+
+	GLint bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	if( bits == 0 )
+	{
+		VV_WARN("GPU profiler disabled: the driver has no timestamp queries");
+		return false;
+	}
+
+	glGenQueries(frame_latency * max_zones_per_frame * 2, &m_queries[0][0]);
+
+	for(Frame &frame: m_frames)
+		frame = Frame();
+
+	m_current = 0;
+	m_frame_index = 0;
+	m_in_frame = false;
+	m_enabled = true;
+	return true;
+}
+
+void GpuProfiler::shutdown()
+{
+	if( !m_enabled )
+		return;
+
+	glDeleteQueries(frame_latency * max_zones_per_frame * 2, &m_queries[0][0]);
+	m_enabled = false;
+
+	if( m_timed_frames > 0 )
+	{
+		VV_INFO("GPU profiler: render thread", m_total_cpu_ms / m_timed_frames, "ms, GPU", m_total_gpu_ms / m_timed_frames,
+			"ms per frame on average over", m_timed_frames, "frames");
+	}
+
+	if( m_dropped_frames > 0 )
+		VV_INFO("GPU profiler:", m_dropped_frames, "frames were still running", frame_latency, "frames later, not timed");
+}
+
+void GpuProfiler::begin_frame( u64 cpu_start )
+{
+	if( !m_enabled )
+		return;
+
+	Frame &frame = m_frames[m_current];
+	if( frame.pending )
+		read_back(frame);
+
+	// both clocks count nanoseconds, the offset only moves with their drift
+	GLint64 gl_now = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gl_now);
+	m_clock_offset = static_cast<i64>(Logger::now()) - gl_now;
+
+	frame.zone_count = 0;
+	frame.index = m_frame_index++;
+	frame.cpu_start = cpu_start;
+	frame.pending = true;
+	m_in_frame = true;
+}
+
+void GpuProfiler::end_frame( u64 cpu_end )
+{
+	if( !m_enabled )
+		return;
+
+	m_frames[m_current].cpu_end = cpu_end;
+	m_current = (m_current + 1) % frame_latency;
+	m_in_frame = false;
+}
+
+u32 GpuProfiler::begin_zone( const char *name )
+{
+	if( !m_in_frame )
+		return no_zone;
+
+	Frame &frame = m_frames[m_current];
+	if( frame.zone_count == max_zones_per_frame )
+		return no_zone;
+
+	u32 index = frame.zone_count++;
+	Zone &zone = frame.zones[index];
+	zone.name = name;
+	zone.start_query = m_queries[m_current][index * 2];
+	zone.end_query = m_queries[m_current][index * 2 + 1];
+
+	glQueryCounter(zone.start_query, GL_TIMESTAMP);
+	frame.last_query = zone.start_query;
+	return index;
+}
+
+void GpuProfiler::end_zone( u32 zone )
+{
+	Frame &frame = m_frames[m_current];
+	if( !m_in_frame || zone >= frame.zone_count )
+		return;
+
+	glQueryCounter(frame.zones[zone].end_query, GL_TIMESTAMP);
+	frame.last_query = frame.zones[zone].end_query;
+}
+
+void GpuProfiler::read_back( Frame &frame )
+{
+	frame.pending = false;
+	if( frame.zone_count == 0 )
+		return;
+
+	GLuint available = 0;
+	glGetQueryObjectuiv(frame.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if( !available )
+	{
+		++m_dropped_frames;
+		return;
+	}
+
+	u64 first = ~0ull;
+	u64 last = 0;
+
+	for(u32 i = 0; i < frame.zone_count; ++i)
+	{
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(frame.zones[i].start_query, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.zones[i].end_query, GL_QUERY_RESULT, &end);
+
+		first = std::min<u64>(first, start);
+		last = std::max<u64>(last, end);
+
+		Profiler::record_gpu(frame.zones[i].name, start + m_clock_offset, end + m_clock_offset);
+	}
+
+	m_last_timing.frame = frame.index;
+	m_last_timing.cpu_ms = static_cast<double>(frame.cpu_end - frame.cpu_start) * 1e-6;
+	m_last_timing.gpu_ms = last > first ? static_cast<double>(last - first) * 1e-6 : 0.0;
+
+	++m_timed_frames;
+	m_total_cpu_ms += m_last_timing.cpu_ms;
+	m_total_gpu_ms += m_last_timing.gpu_ms;
+}
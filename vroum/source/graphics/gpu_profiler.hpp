@@ -0,0 +1,106 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+namespace vv
+{
+
+// GPU time of one executed frame, next to the render thread's CPU time for it
+struct GpuFrameTiming
+{
+	u64 frame = 0;
+	double cpu_ms = 0.0; // execute_frame on the render thread, swap included
+	double gpu_ms = 0.0; // first to last command of the frame on the GPU
+};
+
+// Times command groups on the GPU with timestamp queries (glQueryCounter),
+// render thread only. Every frame uses its own part of a query pool, read
+// back `frame_latency` frames later: results that still aren't there are
+// dropped rather than waited for. Zones go to the profiler captures on a
+// "gpu" track, on the same clock as the CPU zones.
+class GpuProfiler
+{
+public:
+	static constexpr u32 frame_latency = 4;
+	static constexpr u32 max_zones_per_frame = 128; // later zones of a frame aren't timed
+	static constexpr u32 no_zone = max_zones_per_frame;
+
+	GpuProfiler() = default;
+
+	GpuProfiler( const GpuProfiler & ) = delete;
+	GpuProfiler &operator=( const GpuProfiler & ) = delete;
+
+	// Needs a current GL context with timer queries (GL 3.3)
+	bool init();
+	void shutdown();
+
+	bool enabled() const { return m_enabled; }
+
+	// Reads back the frame issued frame_latency frames ago, then starts timing a new one
+	void begin_frame( u64 cpu_start );
+	void end_frame( u64 cpu_end );
+
+	// `name` must outlive the program. Returns the zone to end, no_zone
+	// outside of a frame or when the frame is full
+	u32 begin_zone( const char *name );
+	void end_zone( u32 zone );
+
+	// Last frame read back, gpu_ms is 0 until the first one
+	const GpuFrameTiming &last_timing() const { return m_last_timing; }
+
+	u64 dropped_frames() const { return m_dropped_frames; }
+
+private:
+	struct Zone
+	{
+		const char *name;
+		u32 start_query;
+		u32 end_query;
+	};
+
+	struct Frame
+	{
+		Zone zones[max_zones_per_frame];
+		u32 zone_count = 0;
+		u32 last_query = 0; // the last one the GPU writes, queries complete in order
+		u64 index = 0;
+		u64 cpu_start = 0;
+		u64 cpu_end = 0;
+		bool pending = false;
+	};
+
+	void read_back( Frame &frame );
+
+	Frame m_frames[frame_latency];
+	u32 m_queries[frame_latency][max_zones_per_frame * 2];
+	u32 m_current = 0;
+	u64 m_frame_index = 0;
+
+	// steady clock minus GL time, both in nanoseconds
+	i64 m_clock_offset = 0;
+
+	GpuFrameTiming m_last_timing;
+	u64 m_dropped_frames = 0;
+	u64 m_timed_frames = 0;
+	double m_total_cpu_ms = 0.0;
+	double m_total_gpu_ms = 0.0;
+	bool m_enabled = false;
+	bool m_in_frame = false;
+};
+
+// Times the enclosing scope on the GPU
+class GpuZoneScope
+{
+public:
+	GpuZoneScope( GpuProfiler &profiler, const char *name ): m_profiler(profiler), m_zone(profiler.begin_zone(name)) {}
+	~GpuZoneScope() { m_profiler.end_zone(m_zone); }
+
+	GpuZoneScope( const GpuZoneScope & ) = delete;
+	GpuZoneScope &operator=( const GpuZoneScope & ) = delete;
+
+private:
+	GpuProfiler &m_profiler;
+	u32 m_zone;
+};
+
+} // namespace vv
@@ -1,44 +1,210 @@
 #pragma once
 
-#include <variant>
-#include <memory>
+#include "vv_headers.hpp"
+
 #include <SDL3/SDL.h>
 
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
 namespace vv
 {
 
-struct InitializeCmd
+class CommandList;
+
+// Index of a shader loaded with RenderingSystem::load_shader,
+// 0 is the fallback program
+using ShaderHandle = u32;
+
+// Index of a mesh created with RenderingSystem::create_mesh, 0 is none
+using MeshHandle = u32;
+
+// Every command is a plain struct with a static `type` tag. GL names and
+// enums are stored as integers so this header does not need glad.
+// Payloads bigger than a packet live in the CommandList arena and are
+// referenced by pointer, they stay valid until the list is reset.
+
+enum class RenderCmdType: u16
 {
-	InitializeCmd(SDL_Window *window): window(window) {}
-	InitializeCmd() = default;
+	initialize,
+	shutdown,
+	clear,
+	execute_frame,
+	bind_shader,
+	bind_texture,
+	bind_vertex_array,
+	upload_buffer,
+	draw_arrays,
+	draw_elements,
+	draw_bucket,
+	load_shader,
+	create_mesh,
+	draw_overlay,
+	capture_frame,
+	resize,
 
-	SDL_Window *window;
+	count
+};
+
+struct InitializeCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::initialize;
+	SDL_Window *window = nullptr;
 };
 
 struct ShutdownCmd
 {
-	// empty
+	static constexpr RenderCmdType type = RenderCmdType::shutdown;
+};
+
+struct ClearCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::clear;
+	float r = 0.0f, g = 0.0f, b = 0.0f, a = 1.0f;
+};
+
+struct ExecuteFrameCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::execute_frame;
+	CommandList *list = nullptr;
+};
+
+struct BindShaderCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::bind_shader;
+	ShaderHandle shader = 0;
+};
+
+struct BindTextureCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::bind_texture;
+	u32 unit = 0;
+	u32 target = 0;
+	u32 texture = 0;
+};
+
+struct BindVertexArrayCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::bind_vertex_array;
+	u32 vao = 0;
 };
 
-enum class RenderCmdType
+struct UploadBufferCmd
 {
-	initialize, shutdown
+	static constexpr RenderCmdType type = RenderCmdType::upload_buffer;
+	u32 target = 0;
+	u32 buffer = 0;
+	u64 offset = 0;
+	u64 size = 0;
+	const void *data = nullptr; // owned by the command list arena
 };
 
-struct RenderCmd
+struct DrawArraysCmd
 {
-	using RenderCmdVariant = std::variant<
-		std::shared_ptr<InitializeCmd>,
-		ShutdownCmd
-	>;
+	static constexpr RenderCmdType type = RenderCmdType::draw_arrays;
+	u32 mode = 0;
+	i32 first = 0;
+	i32 count = 0;
+	i32 instance_count = 1;
+};
+
+struct DrawElementsCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::draw_elements;
+	u32 mode = 0;
+	i32 count = 0;
+	u32 index_type = 0;
+	i32 base_vertex = 0;
+	u64 index_offset = 0;
+	i32 instance_count = 1;
+};
+
+// Sorts and executes a range of the DrawItems recorded in a CommandList
+struct DrawBucketCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::draw_bucket;
+	const CommandList *list = nullptr;
+	u32 first = 0;
+	u32 count = 0;
+};
+
+// Strings are owned by the command list arena
+struct LoadShaderCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::load_shader;
+	ShaderHandle handle = 0;
+	const char *vs_path = nullptr;
+	const char *fs_path = nullptr;
+	const char *defines = nullptr; // one define per line
+};
+
+// Positions are 4 floats per vertex, both arrays are owned by the command list
+// arena. Without positions the vertex buffer is only allocated
+struct CreateMeshCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::create_mesh;
+	MeshHandle handle = 0;
+	u32 vertex_count = 0;
+	u32 index_count = 0;
+	bool dynamic = false;
+	const float *positions = nullptr;
+	const u32 *indices = nullptr;
+};
+
+// Text drawn over the frame by the StatsOverlay, owned by the command list arena
+struct DrawOverlayCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::draw_overlay;
+	const char *text = nullptr;
+};
+
+// Path owned by the command list arena
+struct CaptureFrameCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::capture_frame;
+	const char *path = nullptr;
+};
+
+// New size in pixels of the window's framebuffer
+struct ResizeCmd
+{
+	static constexpr RenderCmdType type = RenderCmdType::resize;
+	u32 width = 0;
+	u32 height = 0;
+};
+
+// One cache line: a type tag followed by the command stored inline.
+// Trivially copyable, so it moves through the queues with a memcpy.
+struct alignas(64) RenderCmd
+{
+	static constexpr std::size_t payload_size = 56;
 
 	RenderCmd() = default;
 
-	RenderCmd(const RenderCmdType &type, const RenderCmdVariant &data ):
-		type(type), data(data) {}
+	template <typename Cmd>
+	RenderCmd( const Cmd &cmd ):
+		type(Cmd::type)
+	{
+		static_assert(std::is_trivially_copyable<Cmd>::value, "render commands must be trivially copyable");
+		static_assert(sizeof(Cmd) <= payload_size, "render command too big, put its data in the command list arena");
+		std::memcpy(payload, &cmd, sizeof(Cmd));
+	}
+
+	template <typename Cmd>
+	Cmd get() const
+	{
+		assert(type == Cmd::type);
+		Cmd cmd;
+		std::memcpy(&cmd, payload, sizeof(Cmd));
+		return cmd;
+	}
 
-	RenderCmdType type;
-	RenderCmdVariant data;
+	RenderCmdType type = RenderCmdType::count;
+	alignas(8) unsigned char payload[payload_size];
 };
 
-} // namespace vv
\ No newline at end of file
+static_assert(sizeof(RenderCmd) == 64, "RenderCmd should fit in one cache line");
+static_assert(std::is_trivially_copyable<RenderCmd>::value, "RenderCmd must be trivially copyable");
+
+} // namespace vv
@@ -1,12 +1,17 @@
 #include "rendering_system.hpp"
+#include "memory/alloc_profiler.hpp"
+#include "profiling/profiler.hpp"
+#include "threading/thread_name.hpp"
 #include <iostream>
 #include <glad/glad.h>
+#include <cstring>
 
 using namespace vv;
 
 RenderingSystem::RenderingSystem()
 {
-
+	for(auto &state: m_shader_states)
+		state.store(static_cast<u8>(ShaderState::failed), std::memory_order_relaxed);
 }
 
 void RenderingSystem::start_thread()
@@ -17,67 +22,533 @@ void RenderingSystem::start_thread()
 
 void RenderingSystem::worker_loop()
 {
-	m_worker_running = true;
+	set_thread_name("render");
 
-	while(true)
+	while(m_worker_running)
 	{
-		RenderCmd cmd;
+		// Wait for something to do
+		m_command_queue.wait_for_data();
 
-		{
-			// Wait for something to do
-			std::unique_lock<std::mutex> lock(m_mtx);
-			m_cv.wait(lock, [this]() { return !m_command_queue.empty() || !m_worker_running; });
-			
-			// Shutdown if necessary
-			if(!m_worker_running)
-			{
-				VV_DEBUG("Worker loop shutdown");
-				return;
-			}
-			
-			// Get the command at the front
-			cmd = m_command_queue.front();
-			m_command_queue.pop_front();
-
-		} // we now have the command, we can let other thread send messages again
-		
-		// Execute the command
-		execute_cmd(cmd);
+		// Execute every pending command in one batch, the slots
+		// are handed back to the game thread once the batch is done
+		m_command_queue.consume_all([this](RenderCmd &cmd) {
+			if(m_worker_running)
+				execute_cmd(cmd);
+		});
 	}
+
+	VV_DEBUG("Worker loop shutdown");
 }
 
+// One handler per RenderCmdType, in the same order as the enum
+const RenderingSystem::CmdHandler RenderingSystem::s_cmd_handlers[] = {
+	&RenderingSystem::on_initialize,
+	&RenderingSystem::on_shutdown,
+	&RenderingSystem::on_clear,
+	&RenderingSystem::on_execute_frame,
+	&RenderingSystem::on_bind_shader,
+	&RenderingSystem::on_bind_texture,
+	&RenderingSystem::on_bind_vertex_array,
+	&RenderingSystem::on_upload_buffer,
+	&RenderingSystem::on_draw_arrays,
+	&RenderingSystem::on_draw_elements,
+	&RenderingSystem::on_draw_bucket,
+	&RenderingSystem::on_load_shader,
+	&RenderingSystem::on_create_mesh,
+	&RenderingSystem::on_draw_overlay,
+	&RenderingSystem::on_capture_frame,
+	&RenderingSystem::on_resize,
+};
+
+// Profiler zone of each RenderCmdType, same order
+static const char *const s_cmd_zone_names[] = {
+	"initialize",
+	"shutdown",
+	"clear",
+	"execute frame",
+	"bind shader",
+	"bind texture",
+	"bind vertex array",
+	"upload buffer",
+	"draw arrays",
+	"draw elements",
+	"draw bucket",
+	"load shader",
+	"create mesh",
+	"draw overlay",
+	"capture frame",
+	"resize",
+};
+
+// Whether a RenderCmdType gets a GPU zone, same order. Binds only change
+// state, and every zone costs two queries out of max_zones_per_frame
+const bool RenderingSystem::s_cmd_gpu_timed[] = {
+	false, // initialize
+	false, // shutdown
+	true,  // clear
+	false, // execute frame
+	false, // bind shader
+	false, // bind texture
+	false, // bind vertex array
+	true,  // upload buffer
+	true,  // draw arrays
+	true,  // draw elements
+	true,  // draw bucket
+	false, // load shader
+	false, // create mesh
+	true,  // draw overlay
+	false, // capture frame
+	false, // resize
+};
+
 void RenderingSystem::execute_cmd(const RenderCmd &cmd)
 {
-	switch(cmd.type)
+	static_assert(sizeof(s_cmd_handlers) / sizeof(s_cmd_handlers[0]) == static_cast<std::size_t>(RenderCmdType::count),
+		"every RenderCmdType needs a handler");
+	static_assert(sizeof(s_cmd_zone_names) / sizeof(s_cmd_zone_names[0]) == static_cast<std::size_t>(RenderCmdType::count),
+		"every RenderCmdType needs a zone name");
+	static_assert(sizeof(s_cmd_gpu_timed) / sizeof(s_cmd_gpu_timed[0]) == static_cast<std::size_t>(RenderCmdType::count),
+		"every RenderCmdType needs a GPU timing flag");
+
+	assert(cmd.type < RenderCmdType::count);
+	std::size_t type = static_cast<std::size_t>(cmd.type);
+	VV_PROFILE_SCOPE(s_cmd_zone_names[type]);
+
+	u32 gpu_zone = s_cmd_gpu_timed[type] ? m_gpu_profiler.begin_zone(s_cmd_zone_names[type]) : GpuProfiler::no_zone;
+	(this->*s_cmd_handlers[type])(cmd);
+	m_gpu_profiler.end_zone(gpu_zone);
+}
+
+void RenderingSystem::on_initialize(const RenderCmd &cmd)
+{
+	this->init_opengl(cmd.get<InitializeCmd>().window);
+}
+
+void RenderingSystem::on_shutdown(const RenderCmd &)
+{
+	this->shutdown_opengl();
+}
+
+void RenderingSystem::on_clear(const RenderCmd &cmd)
+{
+	ClearCmd clear = cmd.get<ClearCmd>();
+	m_gl_state.set_depth_mask(true); // glClear honors the depth mask
+	glClearColor(clear.r, clear.g, clear.b, clear.a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+void RenderingSystem::on_execute_frame(const RenderCmd &cmd)
+{
+	this->execute_frame(*cmd.get<ExecuteFrameCmd>().list);
+}
+
+void RenderingSystem::on_bind_shader(const RenderCmd &cmd)
+{
+	m_gl_state.use_program(m_shaders.program(cmd.get<BindShaderCmd>().shader));
+}
+
+void RenderingSystem::on_bind_texture(const RenderCmd &cmd)
+{
+	BindTextureCmd bind = cmd.get<BindTextureCmd>();
+	m_gl_state.bind_texture(bind.unit, bind.target, bind.texture);
+}
+
+void RenderingSystem::on_bind_vertex_array(const RenderCmd &cmd)
+{
+	m_gl_state.bind_vertex_array(cmd.get<BindVertexArrayCmd>().vao);
+}
+
+void RenderingSystem::on_upload_buffer(const RenderCmd &cmd)
+{
+	UploadBufferCmd upload = cmd.get<UploadBufferCmd>();
+	m_gl_state.bind_buffer(upload.target, upload.buffer);
+	glBufferSubData(upload.target, static_cast<GLintptr>(upload.offset), static_cast<GLsizeiptr>(upload.size), upload.data);
+	m_frame_stats.bytes_uploaded += upload.size;
+}
+
+void RenderingSystem::on_draw_arrays(const RenderCmd &cmd)
+{
+	DrawArraysCmd draw = cmd.get<DrawArraysCmd>();
+	glDrawArraysInstanced(draw.mode, draw.first, draw.count, draw.instance_count);
+	++m_frame_stats.draws;
+}
+
+void RenderingSystem::on_draw_elements(const RenderCmd &cmd)
+{
+	DrawElementsCmd draw = cmd.get<DrawElementsCmd>();
+	glDrawElementsInstancedBaseVertex(draw.mode, draw.count, draw.index_type,
+		reinterpret_cast<const void*>(static_cast<std::uintptr_t>(draw.index_offset)), draw.instance_count, draw.base_vertex);
+	++m_frame_stats.draws;
+}
+
+void RenderingSystem::on_draw_bucket(const RenderCmd &cmd)
+{
+	DrawBucketCmd bucket = cmd.get<DrawBucketCmd>();
+	const DrawItem *items = bucket.list->draw_items() + bucket.first;
+
+	// sort the keys only, the items themselves are never moved
+	m_sort_entries.resize(bucket.count);
+	m_sort_scratch.resize(bucket.count);
+
+	for(u32 i = 0; i < bucket.count; ++i)
+		m_sort_entries[i] = DrawSortEntry{ items[i].key, i };
+
+	radix_sort(m_sort_entries.data(), m_sort_scratch.data(), bucket.count);
+
+	// neighbours share most of their state, the cache only sends the changes
+	m_gl_state.set_depth_test(true);
+
+	for(const DrawSortEntry &entry: m_sort_entries)
+	{
+		const DrawItem &item = items[entry.index];
+
+		// translucent draws come last in each layer and need blending
+		bool translucent = draw_key::pass(item.key) == DrawPass::translucent;
+		m_gl_state.set_blend(translucent);
+		m_gl_state.set_depth_mask(!translucent);
+		if( translucent )
+			m_gl_state.set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		m_gl_state.use_program(m_shaders.program(item.shader));
+		m_gl_state.bind_texture(0, GL_TEXTURE_2D, item.texture);
+		m_gl_state.bind_vertex_array(item.vao);
+
+		execute_draw(item);
+	}
+
+	m_gl_state.set_blend(false);
+	m_gl_state.set_depth_mask(true);
+}
+
+void RenderingSystem::on_load_shader(const RenderCmd &cmd)
+{
+	LoadShaderCmd load = cmd.get<LoadShaderCmd>();
+
+	std::vector<std::string> defines;
+	for(const char *define = load.defines; define && *define; )
+	{
+		const char *end = std::strchr(define, '\n');
+		defines.emplace_back(define, end ? end - define : std::strlen(define));
+		define = end ? end + 1 : nullptr;
+	}
+
+	m_shaders.load(load.handle, load.vs_path, load.fs_path, defines);
+}
+
+void RenderingSystem::on_create_mesh(const RenderCmd &cmd)
+{
+	CreateMeshCmd create = cmd.get<CreateMeshCmd>();
+	GLenum usage = create.dynamic ? GL_STREAM_DRAW : GL_STATIC_DRAW;
+
+	GLuint vertex_array = 0, vertex_buffer = 0, index_buffer = 0;
+	glGenVertexArrays(1, &vertex_array);
+	glGenBuffers(1, &vertex_buffer);
+
+	m_gl_state.bind_vertex_array(vertex_array);
+	m_gl_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(create.vertex_count) * 4 * sizeof(float), create.positions, usage);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
+
+	// the element buffer binding belongs to the vertex array
+	if( create.index_count > 0 )
+	{
+		glGenBuffers(1, &index_buffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(create.index_count) * sizeof(u32), create.indices, GL_STATIC_DRAW);
+	}
+
+	m_frame_stats.bytes_uploaded += (create.positions ? create.vertex_count * 4 * sizeof(float) : 0) + create.index_count * sizeof(u32);
+
+	MeshNames &names = m_meshes[create.handle];
+	names.vertex_buffer.store(vertex_buffer, std::memory_order_relaxed);
+	names.index_buffer.store(index_buffer, std::memory_order_relaxed);
+	names.vertex_array.store(vertex_array, std::memory_order_release);
+}
+
+void RenderingSystem::on_draw_overlay(const RenderCmd &cmd)
+{
+	if( !m_overlay.ready() )
+	{
+		if( m_overlay_failed )
+			return;
+
+		m_overlay_failed = !m_overlay.init(m_gl_state);
+		if( m_overlay_failed )
+			return;
+	}
+
+	m_frame_stats.bytes_uploaded += m_overlay.draw(m_gl_state, cmd.get<DrawOverlayCmd>().text, m_framebuffer_width, m_framebuffer_height);
+	++m_frame_stats.draws;
+}
+
+void RenderingSystem::on_resize(const RenderCmd &cmd)
+{
+	// the framebuffer object keeps the size it was created with
+	if( !m_opengl_initialized || m_offscreen )
+		return;
+
+	// a minimized window reports 0, the last valid size stays
+	ResizeCmd resize = cmd.get<ResizeCmd>();
+	if( resize.width == 0 || resize.height == 0 )
+		return;
+
+	m_framebuffer_width = resize.width;
+	m_framebuffer_height = resize.height;
+	glViewport(0, 0, resize.width, resize.height);
+}
+
+void RenderingSystem::on_capture_frame(const RenderCmd &cmd)
+{
+	const char *path = cmd.get<CaptureFrameCmd>().path;
+	if( m_framebuffer_width == 0 || m_framebuffer_height == 0 )
+	{
+		VV_WARN("Cannot capture an empty framebuffer", path, "not written");
+		return;
+	}
+
+	std::size_t pitch = static_cast<std::size_t>(m_framebuffer_width) * 4;
+	std::vector<u8> pixels(pitch * m_framebuffer_height);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_framebuffer_width, m_framebuffer_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	// GL rows start at the bottom
+	std::vector<u8> row(pitch);
+	for(std::size_t top = 0, bottom = m_framebuffer_height - 1; top < bottom; ++top, --bottom)
+	{
+		std::memcpy(row.data(), &pixels[top * pitch], pitch);
+		std::memcpy(&pixels[top * pitch], &pixels[bottom * pitch], pitch);
+		std::memcpy(&pixels[bottom * pitch], row.data(), pitch);
+	}
+
+	SDL_Surface *surface = SDL_CreateSurfaceFrom(m_framebuffer_width, m_framebuffer_height, SDL_PIXELFORMAT_RGBA32, pixels.data(), static_cast<int>(pitch));
+	if( surface == nullptr || !SDL_SaveBMP(surface, path) )
+		VV_ERROR("Cannot save the frame capture", path, ":", SDL_GetError());
+	else
+		VV_INFO("Frame captured to", path);
+
+	SDL_DestroySurface(surface);
+}
+
+void RenderingSystem::execute_draw(const DrawItem &item)
+{
+	if( item.index_type == 0 )
+	{
+		glDrawArraysInstanced(item.mode, item.first, item.count, item.instance_count);
+	}
+	else
+	{
+		glDrawElementsInstancedBaseVertex(item.mode, item.count, item.index_type,
+			reinterpret_cast<const void*>(static_cast<std::uintptr_t>(item.index_offset)), item.instance_count, item.first);
+	}
+
+	++m_frame_stats.draws;
+}
+
+void RenderingSystem::execute_frame(CommandList &list)
+{
+	VV_ALLOC_SCOPE("render thread");
+
+	u64 cpu_start = Logger::now();
+	m_frame_stats = RenderFrameStats();
+
+	if(m_opengl_initialized)
+	{
+		// reads back the frame issued GpuProfiler::frame_latency frames ago
+		m_gpu_profiler.begin_frame(cpu_start);
+
+		// pick up the shaders the driver finished compiling in the background
+		m_shaders.poll();
+
+		{
+			GpuZoneScope gpu_frame(m_gpu_profiler, "gpu frame");
+			for(const RenderCmd &cmd: list)
+				execute_cmd(cmd);
+		}
+
+		if( m_offscreen )
+		{
+			VV_PROFILE_SCOPE("wait offscreen frame");
+			wait_offscreen_frame();
+		}
+		else
+		{
+			VV_PROFILE_SCOPE("swap window");
+			SDL_GL_SwapWindow(m_window);
+		}
+
+		m_gpu_profiler.end_frame(Logger::now());
+	}
+
+	GLStateStats gl_stats = m_gl_state.end_frame();
+	m_total_gl_issued += gl_stats.total_issued();
+	m_total_gl_skipped += gl_stats.total_skipped();
+	m_frame_stats.cpu_ms = static_cast<double>(Logger::now() - cpu_start) * 1e-6;
+
 	{
-	case RenderCmdType::initialize:
-		this->init_opengl(std::get< Ref<InitializeCmd> >(cmd.data)->window);
-		break;
-	case RenderCmdType::shutdown:
-		this->shutdown_opengl();
-		break;
-	default:
-		break;
+		std::lock_guard<std::mutex> lock(m_stats_mtx);
+		m_last_frame_gl_stats = gl_stats;
+		m_last_frame_stats = m_frame_stats;
+		m_last_gpu_timing = m_gpu_profiler.last_timing();
 	}
+
+	// the game thread may now record into this list again
+	m_frames_completed.fetch_add(1, std::memory_order_release);
+	notify_if_waiting(m_frames_completed, m_frame_waiting);
 }
 
 void RenderingSystem::send_render_command(const RenderCmd &cmd)
 {
+	m_command_queue.push(cmd);
+}
+
+ShaderHandle RenderingSystem::load_shader(const std::string &vs_path, const std::string &fs_path, const std::vector<std::string> &defines)
+{
+	if( m_next_shader >= ShaderLibrary::max_shaders )
+	{
+		VV_ERROR("Too many shaders, cannot load", vs_path, fs_path);
+		return 0;
+	}
+
+	ShaderHandle handle = m_next_shader++;
+	m_shader_states[handle].store(static_cast<u8>(ShaderState::compiling), std::memory_order_relaxed);
+
+	std::string define_lines;
+	for(const std::string &define: defines)
+		define_lines += define + '\n';
+
+	CommandList &list = command_list();
+
+	LoadShaderCmd cmd;
+	cmd.handle = handle;
+	cmd.vs_path = list.copy_string(vs_path);
+	cmd.fs_path = list.copy_string(fs_path);
+	cmd.defines = list.copy_string(define_lines);
+	list.push(cmd);
+
+	return handle;
+}
+
+MeshHandle RenderingSystem::create_mesh(const float *positions, u32 vertex_count, const u32 *indices, u32 index_count, bool dynamic)
+{
+	if( m_next_mesh >= max_meshes )
+	{
+		VV_ERROR("Too many meshes, cannot create one of", vertex_count, "vertices");
+		return 0;
+	}
+
+	CommandList &list = command_list();
+
+	CreateMeshCmd cmd;
+	cmd.handle = m_next_mesh++;
+	cmd.vertex_count = vertex_count;
+	cmd.index_count = index_count;
+	cmd.dynamic = dynamic;
+
+	if( positions != nullptr )
+	{
+		float *copy = list.arena().allocate_array<float>(std::size_t(vertex_count) * 4);
+		std::memcpy(copy, positions, std::size_t(vertex_count) * 4 * sizeof(float));
+		cmd.positions = copy;
+	}
+
+	if( index_count > 0 )
+	{
+		u32 *copy = list.arena().allocate_array<u32>(index_count);
+		std::memcpy(copy, indices, std::size_t(index_count) * sizeof(u32));
+		cmd.indices = copy;
+	}
+
+	list.push(cmd);
+	return cmd.handle;
+}
+
+MeshBuffers RenderingSystem::mesh_buffers(MeshHandle handle) const
+{
+	MeshBuffers buffers;
+	if( handle == 0 || handle >= max_meshes )
+		return buffers;
+
+	const MeshNames &names = m_meshes[handle];
+	buffers.vertex_array = names.vertex_array.load(std::memory_order_acquire);
+	if( buffers.vertex_array != 0 )
 	{
-		std::lock_guard<std::mutex> lock(m_mtx); 	
-		m_command_queue.push_back(cmd);
+		buffers.vertex_buffer = names.vertex_buffer.load(std::memory_order_relaxed);
+		buffers.index_buffer = names.index_buffer.load(std::memory_order_relaxed);
 	}
-	m_cv.notify_one();
+	return buffers;
+}
+
+ShaderState RenderingSystem::shader_state(ShaderHandle handle) const
+{
+	if( handle >= ShaderLibrary::max_shaders )
+		return ShaderState::failed;
+
+	return static_cast<ShaderState>(m_shader_states[handle].load(std::memory_order_acquire));
+}
+
+void RenderingSystem::draw_stats_overlay( const char *text, std::size_t length )
+{
+	// after the draws submitted so far, they are flushed first
+	CommandList &list = command_list();
+	list.flush_draws();
+
+	DrawOverlayCmd cmd;
+	cmd.text = list.copy_string(text, length);
+	list.push(cmd);
+}
+
+void RenderingSystem::capture_frame( const std::string &path )
+{
+	CommandList &list = command_list();
+	list.flush_draws();
+
+	CaptureFrameCmd cmd;
+	cmd.path = list.copy_string(path);
+	list.push(cmd);
 }
 
-bool RenderingSystem::init( SDL_Window *window )
+void RenderingSystem::resize( u32 width, u32 height )
 {
+	send_render_command(ResizeCmd{ width, height });
+}
+
+void RenderingSystem::submit_frame()
+{
+	// one handoff for the whole frame
+	command_list().flush_draws();
+	send_render_command(ExecuteFrameCmd{ &command_list() });
+	++m_frames_submitted;
+	m_record_index = m_frames_submitted % frames_in_flight;
+
+	// the next list was submitted frames_in_flight frames ago, wait until it has been executed
+	u32 required = m_frames_submitted - (frames_in_flight - 1);
+	u32 completed = m_frames_completed.load(std::memory_order_acquire);
+	while( static_cast<i32>(required - completed) > 0 )
+	{
+		wait_while_equal(m_wait_strategy, m_frames_completed, completed, m_frame_waiting);
+		completed = m_frames_completed.load(std::memory_order_acquire);
+	}
+
+	command_list().reset();
+}
+
+bool RenderingSystem::init( SDL_Window *window, const RenderingSettings &settings )
+{
+	m_wait_strategy = settings.wait_strategy;
+	m_gpu_profiling = settings.gpu_profiling;
+	m_offscreen = settings.offscreen;
+	m_vsync = settings.vsync;
+	m_command_queue.set_wait_strategy(settings.wait_strategy);
+
 	// start the rendering thread
 	start_thread();
 
 	// immediatly send a command to the opengl thread
 	// that tells it to initialize opengl on its end
-	RenderCmd cmd (RenderCmdType::initialize, std::make_shared<InitializeCmd>(window));
+	InitializeCmd cmd;
+	cmd.window = window;
 	send_render_command(cmd);
 
 	return true;
@@ -85,12 +556,8 @@ bool RenderingSystem::init( SDL_Window *window )
 
 void RenderingSystem::shutdown()
 {
-	{
-		std::lock_guard<std::mutex> lock(m_mtx);
-		m_command_queue.clear();
-	}
-	
-	send_render_command(RenderCmd(RenderCmdType::shutdown, ShutdownCmd()));
+	// the worker stops executing commands once it reaches this one
+	send_render_command(ShutdownCmd());
 
 	m_gpu_thread.join();
 }
@@ -98,6 +565,7 @@ void RenderingSystem::shutdown()
 void RenderingSystem::init_opengl( SDL_Window *window )
 {
 	m_opengl_initialized = false;
+	m_window = window;
 
 	// Set up the SDL side
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
@@ -131,13 +599,130 @@ void RenderingSystem::init_opengl( SDL_Window *window )
 		return;
 	}
 
+	m_framebuffer_width = static_cast<u32>(w_width);
+	m_framebuffer_height = static_cast<u32>(w_height);
+
+	if( m_offscreen && !init_offscreen_framebuffer() )
+		return;
+
+	// the window is never presented offscreen, keep the driver from waiting on it
+	VSync vsync = m_offscreen ? VSync::off : m_vsync;
+	if( vsync == VSync::adaptive && !SDL_GL_SetSwapInterval(-1) )
+	{
+		VV_WARN("No adaptive vsync:", SDL_GetError(), ", using vsync");
+		vsync = VSync::on;
+	}
+
+	if( vsync != VSync::adaptive && !SDL_GL_SetSwapInterval(vsync == VSync::on ? 1 : 0) )
+		VV_WARN("Cannot set the swap interval:", SDL_GetError());
+
 	glViewport(0, 0, w_width, w_height);
 
+	// from now on every bind / state change on this thread goes through the cache
+	m_gl_state.invalidate();
+	m_gl_state.make_current();
+
+	m_shaders.init(m_shader_states);
+
+	if( m_gpu_profiling )
+		m_gpu_profiler.init();
+
 	m_opengl_initialized = true;
 }
 
+bool RenderingSystem::init_offscreen_framebuffer()
+{
+	glGenRenderbuffers(2, m_offscreen_renderbuffers);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, m_offscreen_renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_framebuffer_width, m_framebuffer_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_offscreen_renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_framebuffer_width, m_framebuffer_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// stays bound for the whole run, every draw and capture goes to it
+	glGenFramebuffers(1, &m_offscreen_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_offscreen_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_offscreen_renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_offscreen_renderbuffers[1]);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		VV_ERROR("Offscreen framebuffer incomplete, status", status);
+		return false;
+	}
+
+	VV_INFO("Rendering offscreen into a", m_framebuffer_width, "x", m_framebuffer_height, "framebuffer");
+	return true;
+}
+
+void RenderingSystem::wait_offscreen_frame()
+{
+	void *&fence = m_offscreen_fences[m_offscreen_frame];
+	if( fence != nullptr )
+	{
+		glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(static_cast<GLsync>(fence));
+	}
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	m_offscreen_frame = (m_offscreen_frame + 1) % offscreen_frames_in_flight;
+}
+
+GLStateStats RenderingSystem::last_frame_gl_stats()
+{
+	std::lock_guard<std::mutex> lock(m_stats_mtx);
+	return m_last_frame_gl_stats;
+}
+
+RenderFrameStats RenderingSystem::last_frame_stats()
+{
+	std::lock_guard<std::mutex> lock(m_stats_mtx);
+	return m_last_frame_stats;
+}
+
+GpuFrameTiming RenderingSystem::last_gpu_timing()
+{
+	std::lock_guard<std::mutex> lock(m_stats_mtx);
+	return m_last_gpu_timing;
+}
+
 void RenderingSystem::shutdown_opengl()
 {
+	VV_INFO("GL state cache:", m_total_gl_issued, "calls issued,", m_total_gl_skipped, "redundant calls skipped");
+
+	m_gpu_profiler.shutdown();
+	m_overlay.shutdown(m_gl_state);
+
+	for(MeshNames &names: m_meshes)
+	{
+		GLuint vertex_array = names.vertex_array.exchange(0, std::memory_order_relaxed);
+		GLuint buffers[2] = { names.vertex_buffer.exchange(0, std::memory_order_relaxed), names.index_buffer.exchange(0, std::memory_order_relaxed) };
+		if( vertex_array != 0 )
+		{
+			glDeleteVertexArrays(1, &vertex_array);
+			glDeleteBuffers(2, buffers);
+		}
+	}
+	m_shaders.shutdown();
+
+	for(void *&fence: m_offscreen_fences)
+	{
+		if( fence != nullptr )
+			glDeleteSync(static_cast<GLsync>(fence));
+		fence = nullptr;
+	}
+
+	if( m_offscreen_framebuffer != 0 )
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &m_offscreen_framebuffer);
+		glDeleteRenderbuffers(2, m_offscreen_renderbuffers);
+		m_offscreen_framebuffer = 0;
+	}
+
 	SDL_GL_DestroyContext(m_context);
 	m_worker_running = false;
 }
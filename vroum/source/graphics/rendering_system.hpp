@@ -3,18 +3,58 @@
 #include "vv_headers.hpp"
 #include "core/shader.hpp"
 #include "render_cmd.hpp"
+#include "command_list.hpp"
+#include "gl_state_cache.hpp"
+#include "gpu_profiler.hpp"
+#include "stats_overlay.hpp"
+#include "shader_library.hpp"
+#include "threading/spsc_ring.hpp"
 
 #include <SDL3/SDL.h>
 
-#include <deque>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <memory>
-#include <condition_variable>
+#include <string>
+#include <vector>
 
 namespace vv
 {
+
+// Work done by the render thread for one executed frame
+struct RenderFrameStats
+{
+	u32 draws = 0;
+	u64 bytes_uploaded = 0;
+	double cpu_ms = 0.0; // execute_frame, swap included
+};
+
+// GL names of a mesh, all 0 until the render thread created it
+struct MeshBuffers
+{
+	u32 vertex_array = 0;
+	u32 vertex_buffer = 0;
+	u32 index_buffer = 0; // 0 for a mesh without indices
+};
+
+enum class VSync: u8
+{
+	off,
+	on,
+	adaptive, // tears instead of waiting for the next refresh when a frame is late
+};
+
+struct RenderingSettings
+{
+	WaitStrategy wait_strategy;
+	bool gpu_profiling = true; // times the frames on the GPU too, see GpuProfiler
+	VSync vsync = VSync::on;
+
+	// renders into a framebuffer object the size of the window instead of
+	// its back buffer, nothing is presented and frames are never vsynced
+	bool offscreen = false;
+};
 	
 class RenderingSystem
 {
@@ -24,11 +64,62 @@ public:
 	RenderingSystem(const RenderingSystem &) = delete;
 	RenderingSystem &operator=(const RenderingSystem &) = delete;
 
-	bool init( SDL_Window *window );
+	bool init( SDL_Window *window, const RenderingSettings &settings = {} );
 
 	void shutdown();
 
-	void send_render_command(const RenderCmd &hello);
+	// Must only be called from the game thread (single producer)
+	void send_render_command(const RenderCmd &cmd);
+
+	// List the layers record into for the current frame. From the game thread,
+	// or from the one frame task at a time writing resources::command_list
+	CommandList &command_list() { return m_frame_lists[m_record_index]; }
+
+	// Queues a shader compile on the render thread and returns immediately.
+	// Draws using the handle go through a fallback program until it is ready
+	ShaderHandle load_shader(const std::string &vs_path, const std::string &fs_path, const std::vector<std::string> &defines = {});
+
+	ShaderState shader_state(ShaderHandle handle) const;
+	bool shader_ready(ShaderHandle handle) const { return shader_state(handle) == ShaderState::ready; }
+
+	static constexpr u32 max_meshes = 1024;
+
+	// Queues the creation of a mesh on the render thread and returns immediately.
+	// Positions are 4 floats per vertex on attribute 0, indices are optional,
+	// both are copied. A dynamic mesh is meant to be rewritten every frame with
+	// CommandList::upload_buffer, `positions` can then be null
+	MeshHandle create_mesh(const float *positions, u32 vertex_count, const u32 *indices, u32 index_count, bool dynamic = false);
+
+	MeshBuffers mesh_buffers(MeshHandle handle) const;
+
+	// Records a draw for the current frame, draws are sorted on their key
+	// by the render thread (see draw_key::make)
+	void submit_draw(const DrawItem &item) { command_list().submit_draw(item); }
+
+	// Draws `text` over everything recorded so far this frame with the
+	// StatsOverlay, `text` is copied
+	void draw_stats_overlay( const char *text, std::size_t length );
+
+	// Saves what was recorded so far this frame to a BMP file once the render
+	// thread reaches it, works offscreen too
+	void capture_frame( const std::string &path );
+
+	// The window's framebuffer is now `width` x `height` pixels, from the game
+	// thread. The following frames and the overlay use that size, offscreen
+	// rendering keeps its own
+	void resize( u32 width, u32 height );
+
+	// Hands the recorded frame to the render thread in one go, then waits
+	// until the previous frame is done so its list can be recorded again
+	void submit_frame();
+
+	// GL calls sent to the driver / dropped by the state cache during the last executed frame
+	GLStateStats last_frame_gl_stats();
+
+	RenderFrameStats last_frame_stats();
+
+	// GPU and render thread time of the last frame read back, a few frames old
+	GpuFrameTiming last_gpu_timing();
 	
 private:
 	
@@ -42,13 +133,100 @@ private:
 
 	void execute_cmd(const RenderCmd &cmd);
 
-	std::mutex m_mtx;
-	std::condition_variable m_cv;
-	std::deque<RenderCmd> m_command_queue;
+	void execute_frame(CommandList &list);
+
+	// command handlers, dispatched through s_cmd_handlers
+	void on_initialize(const RenderCmd &cmd);
+	void on_shutdown(const RenderCmd &cmd);
+	void on_clear(const RenderCmd &cmd);
+	void on_execute_frame(const RenderCmd &cmd);
+	void on_bind_shader(const RenderCmd &cmd);
+	void on_bind_texture(const RenderCmd &cmd);
+	void on_bind_vertex_array(const RenderCmd &cmd);
+	void on_upload_buffer(const RenderCmd &cmd);
+	void on_draw_arrays(const RenderCmd &cmd);
+	void on_draw_elements(const RenderCmd &cmd);
+	void on_draw_bucket(const RenderCmd &cmd);
+	void on_load_shader(const RenderCmd &cmd);
+	void on_create_mesh(const RenderCmd &cmd);
+	void on_draw_overlay(const RenderCmd &cmd);
+	void on_capture_frame(const RenderCmd &cmd);
+	void on_resize(const RenderCmd &cmd);
+
+	bool init_offscreen_framebuffer();
+
+	// offscreen frames are not throttled by a swap, the render thread
+	// waits for the frame issued offscreen_frames_in_flight frames ago
+	void wait_offscreen_frame();
+
+	void execute_draw(const DrawItem &item);
+
+	using CmdHandler = void (RenderingSystem::*)(const RenderCmd &);
+	static const CmdHandler s_cmd_handlers[];
+	static const bool s_cmd_gpu_timed[];
+
+	static constexpr u32 command_queue_capacity = 4096;
+
+	SpscRing<RenderCmd, command_queue_capacity> m_command_queue;
 	std::thread m_gpu_thread;
 	bool m_worker_running = true;
+	WaitStrategy m_wait_strategy;
+
+	// game thread records frame N+1 while the render thread executes frame N
+	static constexpr u32 frames_in_flight = 2;
+
+	CommandList m_frame_lists[frames_in_flight];
+	std::vector<DrawSortEntry> m_sort_entries; // render thread only
+	std::vector<DrawSortEntry> m_sort_scratch;
+	u32 m_record_index = 0;
+	u32 m_frames_submitted = 0;
+	alignas(cache_line_size) std::atomic<u32> m_frames_completed { 0 };
+	alignas(cache_line_size) std::atomic<u32> m_frame_waiting { 0 };
+
+	// written by the render thread, read by the game thread
+	std::atomic<u8> m_shader_states[ShaderLibrary::max_shaders];
+	ShaderHandle m_next_shader = 1; // game thread
+
+	// written by the render thread, the vertex array last
+	struct MeshNames
+	{
+		std::atomic<u32> vertex_array { 0 };
+		std::atomic<u32> vertex_buffer { 0 };
+		std::atomic<u32> index_buffer { 0 };
+	};
+
+	MeshNames m_meshes[max_meshes];
+	MeshHandle m_next_mesh = 1; // game thread
+
+	// render thread only
+	ShaderLibrary m_shaders;
+	GLStateCache m_gl_state;
+	u64 m_total_gl_issued = 0;
+	u64 m_total_gl_skipped = 0;
+	GpuProfiler m_gpu_profiler;
+	bool m_gpu_profiling = true;
+	bool m_offscreen = false;
+	VSync m_vsync = VSync::on;
+	u32 m_framebuffer_width = 0;
+	u32 m_framebuffer_height = 0;
+	u32 m_offscreen_framebuffer = 0;
+	u32 m_offscreen_renderbuffers[2] = {}; // color, depth stencil
+
+	static constexpr u32 offscreen_frames_in_flight = 2;
+	void *m_offscreen_fences[offscreen_frames_in_flight] = {}; // GLsync
+	u32 m_offscreen_frame = 0;
+
+	StatsOverlay m_overlay; // initialized on its first draw
+	bool m_overlay_failed = false;
+	RenderFrameStats m_frame_stats;
+
+	std::mutex m_stats_mtx;
+	GLStateStats m_last_frame_gl_stats;
+	RenderFrameStats m_last_frame_stats;
+	GpuFrameTiming m_last_gpu_timing;
 
 	bool m_opengl_initialized = false;
+	SDL_Window *m_window = nullptr;
 	SDL_GLContext m_context;
 };
 
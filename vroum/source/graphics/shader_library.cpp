@@ -0,0 +1,95 @@
+#include "shader_library.hpp"
+
+#include <glad/glad.h>
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+
+using namespace vv;
+
+using PFNGLMAXSHADERCOMPILERTHREADSKHRPROC = void (APIENTRYP)(GLuint count);
+
+static const char *s_fallback_vs = R"(#version 330 core
+layout (location = 0) in vec3 position;
+void main() { gl_Position = vec4(position, 1.0); }
+)";
+
+static const char *s_fallback_fs = R"(#version 330 core
+out vec4 color;
+void main() { color = vec4(1.0, 0.0, 1.0, 1.0); }
+)";
+
+void ShaderLibrary::init( std::atomic<u8> *states )
+{
+	m_states = states;
+
+	// let the driver use as many compiler threads as it wants
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC max_threads = nullptr;
+	if( SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile") )
+		max_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+	else if( SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile") )
+		max_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB"));
+
+	m_parallel_compile = max_threads != nullptr;
+	if( m_parallel_compile )
+		max_threads(0xFFFFFFFF);
+
+	VV_INFO("Parallel shader compilation:", m_parallel_compile ? "enabled" : "not supported, shaders are finished one per frame");
+
+	m_fallback = Shader::from_source(s_fallback_vs, s_fallback_fs, "fallback");
+}
+
+void ShaderLibrary::shutdown()
+{
+	m_pending.clear();
+	for(auto &shader: m_shaders)
+		shader.reset();
+	m_fallback.reset();
+}
+
+void ShaderLibrary::load( ShaderHandle handle, const std::string &vs_path, const std::string &fs_path, const std::vector<std::string> &defines )
+{
+	assert( handle > 0 && handle < max_shaders );
+
+	m_shaders[handle] = std::make_unique<Shader>(vs_path, fs_path, defines, ShaderLoad::async);
+
+	if( m_shaders[handle]->state() == ShaderState::compiling )
+		m_pending.push_back(handle);
+	else
+		set_state(handle, m_shaders[handle]->state());
+}
+
+void ShaderLibrary::poll()
+{
+	// without completion queries, checking a shader waits for it:
+	// only finish one per frame so a batch of loads never stalls a single frame
+	bool finished_one = false;
+
+	auto done = [this, &finished_one](ShaderHandle handle) {
+		if( !m_parallel_compile && finished_one )
+			return false;
+
+		ShaderState state = m_shaders[handle]->poll(m_parallel_compile);
+		if( state == ShaderState::compiling )
+			return false;
+
+		finished_one = true;
+		set_state(handle, state);
+		return true;
+	};
+
+	m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), done), m_pending.end());
+}
+
+u32 ShaderLibrary::program( ShaderHandle handle ) const
+{
+	if( handle < max_shaders && m_shaders[handle] && m_shaders[handle]->state() == ShaderState::ready )
+		return m_shaders[handle]->id();
+
+	return m_fallback ? m_fallback->id() : 0;
+}
+
+void ShaderLibrary::set_state( ShaderHandle handle, ShaderState state )
+{
+	m_states[handle].store(static_cast<u8>(state), std::memory_order_release);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "render_cmd.hpp"
+#include "core/shader.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vv
+{
+
+// Render thread side of the shaders loaded through RenderingSystem::load_shader.
+// Every compile and link is queued up front, then poll() picks up the programs
+// the driver finished (KHR_parallel_shader_compile when available). Until then,
+// or if it failed, a handle resolves to a flat fallback program.
+class ShaderLibrary
+{
+public:
+	static constexpr u32 max_shaders = 256;
+
+	// `states` is shared with the game thread, one entry per handle
+	void init( std::atomic<u8> *states );
+	void shutdown();
+
+	void load( ShaderHandle handle, const std::string &vs_path, const std::string &fs_path, const std::vector<std::string> &defines );
+
+	// Non blocking when the driver compiles in parallel
+	void poll();
+
+	// GL program to use for this handle right now
+	u32 program( ShaderHandle handle ) const;
+
+	bool parallel_compile() const { return m_parallel_compile; }
+
+private:
+	void set_state( ShaderHandle handle, ShaderState state );
+
+	std::unique_ptr<Shader> m_fallback;
+	std::unique_ptr<Shader> m_shaders[max_shaders];
+	std::vector<ShaderHandle> m_pending;
+	std::atomic<u8> *m_states = nullptr;
+	bool m_parallel_compile = false;
+};
+
+} // namespace vv
@@ -0,0 +1,256 @@
+#include "stats_overlay.hpp"
+#include "gl_state_cache.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+
+using namespace vv;
+
+static constexpr u32 glyph_width = 5;
+static constexpr u32 glyph_height = 7;
+static constexpr u32 first_char = 32;
+static constexpr u32 char_count = 64;    // ' ' to '_', lowercase is drawn as capitals
+static constexpr u32 panel_glyph = char_count; // fully covered, after the characters
+static constexpr u32 unknown_glyph = '?' - first_char;
+
+static constexpr u32 advance_x = (glyph_width + 1) * StatsOverlay::glyph_scale;
+static constexpr u32 advance_y = (glyph_height + 3) * StatsOverlay::glyph_scale;
+static constexpr u32 margin = 8;
+static constexpr u32 padding = 6;
+
+static constexpr u8 panel_color = 0;
+static constexpr u8 text_color = 1;
+
+// One row per byte, the leftmost pixel is the 5th bit
+static const u8 s_font[char_count][glyph_height] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+	{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // '!'
+	{ 0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00 }, // '"'
+	{ 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a }, // '#'
+	{ 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04 }, // '$'
+	{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+	{ 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d }, // '&'
+	{ 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '\''
+	{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+	{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ')'
+	{ 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00 }, // '*'
+	{ 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 }, // '+'
+	{ 0x00, 0x00, 0x00, 0x00, 0x06, 0x04, 0x08 }, // ','
+	{ 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 }, // '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c }, // '.'
+	{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+	{ 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e }, // '0'
+	{ 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e }, // '1'
+	{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f }, // '2'
+	{ 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e }, // '3'
+	{ 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 }, // '4'
+	{ 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e }, // '5'
+	{ 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e }, // '6'
+	{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+	{ 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e }, // '8'
+	{ 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c }, // '9'
+	{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 }, // ':'
+	{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08 }, // ';'
+	{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // '<'
+	{ 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00 }, // '='
+	{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // '>'
+	{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '?'
+	{ 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e }, // '@'
+	{ 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, // 'A'
+	{ 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e }, // 'B'
+	{ 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e }, // 'C'
+	{ 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c }, // 'D'
+	{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f }, // 'E'
+	{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 }, // 'F'
+	{ 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f }, // 'G'
+	{ 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, // 'H'
+	{ 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e }, // 'I'
+	{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c }, // 'J'
+	{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+	{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f }, // 'L'
+	{ 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+	{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+	{ 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, // 'O'
+	{ 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 }, // 'P'
+	{ 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d }, // 'Q'
+	{ 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 }, // 'R'
+	{ 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e }, // 'S'
+	{ 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+	{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, // 'U'
+	{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 }, // 'V'
+	{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a }, // 'W'
+	{ 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 }, // 'X'
+	{ 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04 }, // 'Y'
+	{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f }, // 'Z'
+	{ 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e }, // '['
+	{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, // '\\'
+	{ 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e }, // ']'
+	{ 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00 }, // '^'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f }, // '_'
+};
+
+static const char *s_overlay_vs = R"(#version 330 core
+layout (location = 0) in ivec4 rect;
+layout (location = 1) in uvec2 glyph_color;
+uniform vec2 u_screen_size;
+flat out uint glyph;
+flat out uint color;
+out vec2 texel;
+const vec2 corners[6] = vec2[6](vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(0, 0), vec2(1, 1), vec2(0, 1));
+void main()
+{
+	vec2 corner = corners[gl_VertexID];
+	vec2 pixel = vec2(rect.xy) + corner * vec2(rect.zw);
+	gl_Position = vec4(pixel / u_screen_size * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+	glyph = glyph_color.x;
+	color = glyph_color.y;
+	texel = corner * vec2(5.0, 7.0);
+}
+)";
+
+static const char *s_overlay_fs = R"(#version 330 core
+uniform sampler2D u_font;
+flat in uint glyph;
+flat in uint color;
+in vec2 texel;
+out vec4 frag_color;
+const vec4 palette[2] = vec4[2](vec4(0.0, 0.0, 0.0, 0.65), vec4(0.85, 1.0, 0.85, 1.0));
+void main()
+{
+	ivec2 font_texel = ivec2(min(texel, vec2(4.0, 6.0)));
+	if( texelFetch(u_font, ivec2(int(glyph) * 5 + font_texel.x, font_texel.y), 0).r < 0.5 )
+		discard;
+	frag_color = palette[color];
+}
+)";
+
+bool StatsOverlay::init( GLStateCache &state )
+{
+	auto shader = Shader::from_source(s_overlay_vs, s_overlay_fs, "stats overlay");
+	if( !shader || !*shader )
+	{
+		VV_ERROR("Cannot compile the stats overlay shader");
+		return false;
+	}
+
+	state.use_program(shader->id());
+	shader->set(shader->uniform<int>("u_font"), 0);
+	m_screen_size = shader->uniform<glm::vec2>("u_screen_size");
+
+	// every glyph next to the other on one row, one byte per pixel
+	constexpr u32 texture_width = (char_count + 1) * glyph_width;
+	u8 pixels[glyph_height][texture_width] = {};
+	for(u32 y = 0; y < glyph_height; ++y)
+	{
+		for(u32 c = 0; c < char_count; ++c)
+			for(u32 x = 0; x < glyph_width; ++x)
+				pixels[y][c * glyph_width + x] = (s_font[c][y] >> (glyph_width - 1 - x)) & 1 ? 255 : 0;
+
+		for(u32 x = 0; x < glyph_width; ++x)
+			pixels[y][panel_glyph * glyph_width + x] = 255;
+	}
+
+	glGenTextures(1, &m_font_texture);
+	state.bind_texture(0, GL_TEXTURE_2D, m_font_texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, texture_width, glyph_height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glGenVertexArrays(1, &m_vao);
+	glGenBuffers(1, &m_instance_buffer);
+	state.bind_vertex_array(m_vao);
+	state.bind_buffer(GL_ARRAY_BUFFER, m_instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, (max_glyphs + 1) * sizeof(Glyph), nullptr, GL_STREAM_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribIPointer(0, 4, GL_SHORT, sizeof(Glyph), reinterpret_cast<const void*>(offsetof(Glyph, x)));
+	glVertexAttribDivisor(0, 1);
+	glEnableVertexAttribArray(1);
+	glVertexAttribIPointer(1, 2, GL_UNSIGNED_BYTE, sizeof(Glyph), reinterpret_cast<const void*>(offsetof(Glyph, glyph)));
+	glVertexAttribDivisor(1, 1);
+
+	m_glyphs.reserve(max_glyphs + 1);
+	m_shader = std::move(shader);
+	return true;
+}
+
+void StatsOverlay::shutdown( GLStateCache &state )
+{
+	if( !ready() )
+		return;
+
+	// names can be handed out again, they must not look bound anymore
+	state.invalidate();
+	glDeleteBuffers(1, &m_instance_buffer);
+	glDeleteVertexArrays(1, &m_vao);
+	glDeleteTextures(1, &m_font_texture);
+	m_shader.reset();
+}
+
+u64 StatsOverlay::draw( GLStateCache &state, const char *text, u32 width, u32 height )
+{
+	if( !ready() || width == 0 || height == 0 )
+		return 0;
+
+	// the panel comes first so the text is blended over it, sized once the text is laid out
+	m_glyphs.clear();
+	m_glyphs.push_back(Glyph{});
+
+	u32 column = 0, row = 0, columns = 0;
+	for(const char *c = text; *c != '\0' && m_glyphs.size() <= max_glyphs; ++c)
+	{
+		if( *c == '\n' )
+		{
+			++row;
+			column = 0;
+			continue;
+		}
+
+		u32 code = static_cast<u8>(*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c);
+		if( code != ' ' )
+		{
+			Glyph glyph {};
+			glyph.x = static_cast<i16>(margin + padding + column * advance_x);
+			glyph.y = static_cast<i16>(margin + padding + row * advance_y);
+			glyph.width = glyph_width * glyph_scale;
+			glyph.height = glyph_height * glyph_scale;
+			glyph.glyph = static_cast<u8>(code >= first_char && code < first_char + char_count ? code - first_char : unknown_glyph);
+			glyph.color = text_color;
+			m_glyphs.push_back(glyph);
+		}
+
+		columns = std::max(columns, ++column);
+	}
+
+	Glyph &panel = m_glyphs[0];
+	panel.x = margin;
+	panel.y = margin;
+	panel.width = static_cast<i16>(columns * advance_x + padding * 2);
+	panel.height = static_cast<i16>((row + 1) * advance_y + padding * 2);
+	panel.glyph = panel_glyph;
+	panel.color = panel_color;
+
+	u64 size = m_glyphs.size() * sizeof(Glyph);
+	state.bind_buffer(GL_ARRAY_BUFFER, m_instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, (max_glyphs + 1) * sizeof(Glyph), nullptr, GL_STREAM_DRAW); // orphaned, no wait on the last frame
+	glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size), m_glyphs.data());
+
+	state.use_program(m_shader->id());
+	m_shader->set(m_screen_size, glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+	state.bind_texture(0, GL_TEXTURE_2D, m_font_texture);
+	state.bind_vertex_array(m_vao);
+	state.set_depth_test(false);
+	state.set_cull_face(false);
+	state.set_blend(true);
+	state.set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_glyphs.size()));
+
+	state.set_blend(false);
+	return size;
+}
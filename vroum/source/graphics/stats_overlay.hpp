@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "core/shader.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace vv
+{
+
+class GLStateCache;
+
+// Text drawn over the frame with a built-in 5x7 font, render thread only.
+// A panel and every glyph are instances of a single quad, the whole overlay
+// is one upload and one draw call.
+class StatsOverlay
+{
+public:
+	static constexpr u32 max_glyphs = 4096; // the rest of the text is cut
+	static constexpr u32 glyph_scale = 2;   // pixels per font pixel
+
+	StatsOverlay() = default;
+
+	StatsOverlay( const StatsOverlay & ) = delete;
+	StatsOverlay &operator=( const StatsOverlay & ) = delete;
+
+	// Needs a current GL context, every bind goes through `state`
+	bool init( GLStateCache &state );
+	void shutdown( GLStateCache &state );
+
+	bool ready() const { return m_shader != nullptr; }
+
+	// Draws `text` (lines split on '\n') in the top left corner of a
+	// `width` x `height` framebuffer. Returns the bytes uploaded
+	u64 draw( GLStateCache &state, const char *text, u32 width, u32 height );
+
+private:
+	// one instance, a glyph or the panel behind them
+	struct Glyph
+	{
+		i16 x, y, width, height; // in pixels, from the top left corner
+		u8 glyph;                // index in the font texture
+		u8 color;                // index in the shader palette
+		u8 padding[2];
+	};
+
+	std::unique_ptr<Shader> m_shader;
+	Uniform<glm::vec2> m_screen_size;
+	u32 m_font_texture = 0;
+	u32 m_vao = 0;
+	u32 m_instance_buffer = 0;
+	std::vector<Glyph> m_glyphs; // reserved once, max_glyphs + the panel
+};
+
+} // namespace vv
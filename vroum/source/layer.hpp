@@ -2,6 +2,7 @@
 
 #include <SDL3/SDL_events.h>
 #include "vv_errors.hpp"
+#include "threading/task_graph.hpp"
 
 namespace vv
 {
@@ -24,11 +25,29 @@ public:
 
 	virtual void update( double dt_sec ) = 0;
 
+	// Called EngineParameters::fixed_tick_rate times per second of game time, on
+	// the game thread before the frame graph and always with the same dt.
+	// Engine::interpolation_alpha() tells render() how far the frame is past the last tick
+	virtual void fixed_update( double fixed_dt_sec ) { (void)fixed_dt_sec; }
+
 	virtual void on_event( const SDL_Event &event ) = 0;
 
+	// Adds this layer's work to the frame graph. By default update() then render()
+	// on the game thread, every layer sharing the world and recording in the
+	// command list in order. Override it to split the work in finer tasks that
+	// can run in parallel, on any thread unless TaskDesc::game_thread is set.
+	virtual void declare_tasks( FrameTaskGraph &graph, double dt_sec )
+	{
+		graph.add_task({ "layer update", FrameStage::simulation, {}, { resources::world }, true },
+			[this, dt_sec]() { update(dt_sec); });
+
+		graph.add_task({ "layer render", FrameStage::render_prep, { resources::world }, { resources::command_list }, true },
+			[this, dt_sec]() { render(dt_sec); });
+	}
+
 protected:
 	Engine *m_app;
-	RenderingSystem *m_rend;
+	RenderingSystem *m_rend; // null on a server, which skips render() by default, see EngineParameters::server
 };
 
 } // namespace vv
\ No newline at end of file
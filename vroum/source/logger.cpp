@@ -1,22 +1,268 @@
 #include "logger.hpp"
+#include "logging/log_ring.hpp"
 
-#include <sstream>
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 
-void vv::Logger::send_to_streams( std::initializer_list<std::string> init_list )
+using namespace vv;
+
+namespace
+{
+	constexpr auto writer_poll_interval = std::chrono::milliseconds(1);
+
+	// the ring outlives its thread until the logger drained it
+	struct ThreadRing
+	{
+		LogRing *ring = nullptr;
+		~ThreadRing() { if( ring ) ring->close(); }
+	};
+
+	thread_local ThreadRing t_ring;
+}
+
+vv::Logger::Logger()
+{
+	// one fallback site per level, for Logger::log(LogLevel, ...)
+	for(u32 level = 0; level < log_level_count; ++level)
+		m_sites[level].level = static_cast<LogLevel>(level);
+	m_site_count.store(log_level_count, std::memory_order_release);
+
+	m_sinks.push_back( std::make_unique<ConsoleSink>() );
+
+	m_running = true;
+	m_writer = std::thread(&Logger::writer_loop, this);
+}
+
+vv::Logger::~Logger()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_writer_mtx);
+		m_running = false;
+	}
+	m_wake_cv.notify_all();
+	m_writer.join();
+
+	// threads still alive may log until the very end, their rings are leaked on purpose
+	std::lock_guard<std::mutex> lock(m_drain_mtx);
+	while( drain() ) {}
+}
+
+u32 vv::Logger::register_site( LogLevel level, const char *file, u32 line )
+{
+	Logger &logger = get();
+	std::lock_guard<std::mutex> lock(logger.m_sites_mtx);
+
+	u32 id = logger.m_site_count.load(std::memory_order_relaxed);
+	if( id == max_sites )
+		return static_cast<u32>(level);
+
+	logger.m_sites[id] = LogSite { level, file, line };
+	logger.m_site_count.store(id + 1, std::memory_order_release);
+	return id;
+}
+
+u8 vv::Logger::keep_site_literals( u32 site_id, const char *const *literals, u32 count )
+{
+	u8 state = literals_unknown;
+	if( !m_literal_states[site_id].compare_exchange_strong(state, literals_registering, std::memory_order_acquire) )
+		return state;
+
+	// copied: a const char array may as well live on the stack of the caller
+	u32 literal_count = 0;
+	u32 text_size = 0;
+	for(u32 i = 0; i < count; ++i)
+	{
+		if( literals[i] == nullptr )
+			continue;
+
+		++literal_count;
+		text_size += static_cast<u32>(std::min<std::size_t>(std::strlen(literals[i]), log_max_string)) + 1;
+	}
+
+	// the first ids are shared by every Logger::log(LogLevel, ...) call
+	u32 first = 0;
+	u32 text = 0;
+	bool kept = site_id >= log_level_count && literal_count <= log_args::max_site_literals;
+	if( kept )
+	{
+		first = m_literal_count.fetch_add(literal_count, std::memory_order_relaxed);
+		text = m_literal_text_size.fetch_add(text_size, std::memory_order_relaxed);
+		kept = first + literal_count <= max_literals && text + text_size <= max_literal_text;
+	}
+
+	if( kept )
+	{
+		u32 index = first;
+		for(u32 i = 0; i < count; ++i)
+		{
+			if( literals[i] == nullptr )
+				continue;
+
+			std::size_t length = std::min<std::size_t>(std::strlen(literals[i]), log_max_string);
+			char *copy = m_literal_text + text;
+			std::memcpy(copy, literals[i], length);
+			copy[length] = '\0';
+			text += static_cast<u32>(length) + 1;
+			m_literals[index++] = copy;
+		}
+
+		m_sites[site_id].literals = m_literals + first;
+		m_sites[site_id].literal_count = literal_count;
+	}
+
+	state = kept ? literals_kept : literals_inline;
+	m_literal_states[site_id].store(state, std::memory_order_release);
+	return state;
+}
+
+void vv::Logger::add_sink( std::unique_ptr<LogSink> sink )
 {
-	m_mtx.lock();
-	std::stringstream ss;
+	std::lock_guard<std::mutex> lock(m_drain_mtx);
+	m_sinks.push_back( std::move(sink) );
+}
+
+void vv::Logger::clear_sinks()
+{
+	std::lock_guard<std::mutex> lock(m_drain_mtx);
+	m_sinks.clear();
+}
+
+unsigned char *vv::Logger::reserve( u32 size )
+{
+	if( size > LogRing::max_record_size )
+		return nullptr;
+
+	if( t_ring.ring == nullptr )
+	{
+		std::lock_guard<std::mutex> lock(m_rings_mtx);
+		t_ring.ring = new LogRing(m_next_thread++);
+		m_rings.push_back(t_ring.ring);
+	}
+
+	// full: the logger thread is behind, wait for it rather than losing records
+	unsigned char *out;
+	while( (out = t_ring.ring->try_reserve(size)) == nullptr )
+	{
+		m_wake_cv.notify_one();
+		std::this_thread::yield();
+	}
 
-	for(auto &el: init_list)
-		ss << el << ' ';
-	
-	ss << '\n';
-	std::cout << ss.str();
-	m_mtx.unlock();
+	return out;
+}
+
+void vv::Logger::commit( u32 size )
+{
+	t_ring.ring->commit(size);
 }
 
 void vv::Logger::flush()
 {
-	std::cout << std::flush;
+	// from the logger thread itself (a sink logging), or once it stopped
+	if( std::this_thread::get_id() == m_writer.get_id() || !m_writer.joinable() )
+	{
+		std::lock_guard<std::mutex> lock(m_drain_mtx);
+		while( drain() ) {}
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_writer_mtx);
+	u64 ticket = ++m_flush_requested;
+	m_wake_cv.notify_one();
+	m_flushed_cv.wait(lock, [this, ticket]() { return m_flush_done >= ticket || !m_running; });
+}
+
+void vv::Logger::writer_loop()
+{
+	for(;;)
+	{
+		u64 requested;
+		bool running;
+		{
+			std::lock_guard<std::mutex> lock(m_writer_mtx);
+			requested = m_flush_requested;
+			running = m_running;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_drain_mtx);
+			while( drain() ) {}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_writer_mtx);
+			m_flush_done = requested;
+		}
+		m_flushed_cv.notify_all();
+
+		if( !running )
+			break;
+
+		std::unique_lock<std::mutex> lock(m_writer_mtx);
+		m_wake_cv.wait_for(lock, writer_poll_interval, [this, requested]() {
+			return m_flush_requested != requested || !m_running;
+		});
+	}
+}
+
+bool vv::Logger::drain()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_rings_mtx);
+		m_drained_rings = m_rings;
+	}
+
+	bool any = false;
+	for(;;)
+	{
+		// oldest pending record among every thread
+		LogRing *next = nullptr;
+		const LogRecordHeader *next_header = nullptr;
+		for(LogRing *ring: m_drained_rings)
+		{
+			const LogRecordHeader *header = ring->peek();
+			if( header && (next_header == nullptr || header->timestamp < next_header->timestamp) )
+			{
+				next = ring;
+				next_header = header;
+			}
+		}
+
+		if( next == nullptr )
+			break;
+
+		LogRecordView record {
+			m_sites[next_header->site],
+			next_header->site,
+			next->thread_index(),
+			next_header->timestamp,
+			reinterpret_cast<const unsigned char*>(next_header + 1),
+			next_header->size - static_cast<u32>(sizeof(LogRecordHeader))
+		};
+
+		for(auto &sink: m_sinks)
+			sink->write(record);
+
+		next->pop(next_header);
+		any = true;
+	}
+
+	if( any )
+	{
+		for(auto &sink: m_sinks)
+			sink->flush();
+	}
+
+	// rings of the threads that exited, once empty: closed is checked first,
+	// the thread can't write after closing
+	std::lock_guard<std::mutex> lock(m_rings_mtx);
+	m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](LogRing *ring) {
+		if( ring->closed() && ring->peek() == nullptr )
+		{
+			delete ring;
+			return true;
+		}
+		return false;
+	}), m_rings.end());
+
+	return any;
 }
\ No newline at end of file
@@ -1,92 +1,237 @@
 #pragma once
 
-#include <string>
+#include "vv_headers.hpp"
+#include "logging/log_record.hpp"
+#include "logging/log_sink.hpp"
+#include "logging/flight_recorder.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
 #include <mutex>
-
-inline std::string to_string( const std::string &str ) { return str; }
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace vv
 {
 
-enum class LogLevel
-{
-	trace,
-	debug,
-	info,
-	warn,
-	error,
-	fatal
-};
+class LogRing;
 
+// Asynchronous logger. A log call only encodes its raw arguments in a ring
+// owned by the calling thread, no lock and no formatting. The logger thread
+// merges the rings in timestamp order and hands the records to the sinks.
 class Logger
 {
 public:
+	static constexpr u32 max_sites = 4096;
+	static constexpr u32 max_literals = 2 * max_sites;
+	static constexpr u32 max_literal_text = 64 * 1024; // bytes, '\0' included
+
 	Logger(const Logger&)           = delete;
 	Logger operator=(const Logger&) = delete;
 
+	~Logger();
+
 	inline static Logger &get()
 	{
 		static Logger instance;
 		return instance;
 	}
 
+	// Called once by each VV_* line, the first ids are one per level
+	static u32 register_site( LogLevel level, const char *file, u32 line );
+
+	const LogSite &site( u32 id ) const { return m_sites[id]; }
+	u32 site_count() const { return m_site_count.load(std::memory_order_acquire); }
+
+	// The first call of the site decided whether it keeps its literals,
+	// LogSite::literals won't change anymore
+	bool literals_settled( u32 id ) const { return m_literal_states[id].load(std::memory_order_acquire) >= literals_kept; }
+
+	// Records below this level don't reach the sinks. The VV_* macros drop them
+	// before their arguments are evaluated, unless the flight recorder wants them.
+	static void set_level( LogLevel level ) { s_level.store(level, std::memory_order_relaxed); }
+	static LogLevel level() { return s_level.load(std::memory_order_relaxed); }
+	static bool enabled( LogLevel level ) { return level >= s_level.load(std::memory_order_relaxed) || FlightRecorder::records(level); }
+
+	// String literals in `args` (any const char array) are copied in the site
+	// by its first call. Later records only carry the index of the ones still
+	// equal to that copy, an array that changed is written in full
 	template <typename ...types>
-	void log(LogLevel log_level, types&& ...args)
+	void log(u32 site_id, types&& ...args)
 	{
-		using ::to_string;
-		using std::to_string;
+		LogLevel level = m_sites[site_id].level;
+		u64 timestamp = now();
+
+		u32 kept_literals = 0;
+		if constexpr( (false || ... || log_args::is_literal<types>) )
+		{
+			const char *literals[] = { log_args::literal_pointer<types>(args)... };
+			u8 state = m_literal_states[site_id].load(std::memory_order_acquire);
+			if( state == literals_unknown )
+				state = keep_site_literals(site_id, literals, sizeof...(types));
+			if( state == literals_kept )
+				kept_literals = matching_literals(site_id, literals, sizeof...(types));
+		}
+
+		if( FlightRecorder::records(level) )
+			FlightRecorder::record(site_id, timestamp, kept_literals, args...);
+
+		if( level < s_level.load(std::memory_order_relaxed) )
+			return;
+
+		u8 sized = 0;
+		u32 size = sizeof(LogRecordHeader) + (0 + ... + log_args::site_size<types>(args, kept_literals, sized));
+
+		unsigned char *out = reserve(log_padded_size(size));
+		if( out == nullptr )
+			return;
+
+		LogRecordHeader header { size, site_id, timestamp };
+		std::memcpy(out, &header, sizeof(header));
 
-		switch(log_level)
+		unsigned char *it = out + sizeof(header);
+		u8 literal = 0;
+		((it = log_args::site_write<types>(it, args, kept_literals, literal)), ...);
+		(void)literal;
+
+		commit(log_padded_size(size));
+
+		if( level == LogLevel::fatal )
 		{
-			case LogLevel::debug:
-				send_to_streams( { "[DEBUG]:", to_string(args)... } );
-				break;
-			case LogLevel::error:
-				send_to_streams( { "[ERROR]:", to_string(args)... } );
-				break;
-			case LogLevel::fatal:
-				send_to_streams( { "[FATAL]:", to_string(args)... } );
-				break;
-			case LogLevel::info:
-				send_to_streams( { "[INFO ]:", to_string(args)... } );
-				break;
-			case LogLevel::trace:
-				send_to_streams( { "[TRACE]:", to_string(args)... } );
-				break;
-			case LogLevel::warn:
-				send_to_streams( { "[WARN ]:", to_string(args)... } );
-				break;
-			default: break;
+			flush();
+			FlightRecorder::dump("fatal log", true);
 		}
 	}
 
+	// For a level only known at runtime
+	template <typename ...types>
+	void log(LogLevel log_level, types&& ...args)
+	{
+		log(static_cast<u32>(log_level), std::forward<types>(args)...);
+	}
+
+	void add_sink( std::unique_ptr<LogSink> sink );
+	void clear_sinks();
+
+	// Blocks until every record logged before the call went through the sinks
 	void flush();
 
+	static u64 now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
 private:
-	void send_to_streams( std::initializer_list<std::string> init_list );
+	Logger();
+
+	inline static std::atomic<LogLevel> s_level { LogLevel::trace };
+
+	unsigned char *reserve( u32 size );
+	void commit( u32 size );
+
+	// what a site does with its literals, decided by its first call
+	static constexpr u8 literals_unknown = 0;
+	static constexpr u8 literals_registering = 1;
+	static constexpr u8 literals_kept = 2;
+	static constexpr u8 literals_inline = 3; // in every record: a site shared by many lines, or no room left
+
+	// `literals` has one entry per argument, null for the ones that aren't literals.
+	// Returns the site's state, only the first caller registers them
+	u8 keep_site_literals( u32 site_id, const char *const *literals, u32 count );
+
+	// Bit i set when the i-th literal of `literals` still equals the site's copy
+	u32 matching_literals( u32 site_id, const char *const *literals, u32 count ) const
+	{
+		const LogSite &site = m_sites[site_id];
+		u32 matching = 0;
+		u32 literal = 0;
+		for(u32 i = 0; i < count; ++i)
+		{
+			if( literals[i] == nullptr )
+				continue;
 
-	Logger(){}
+			// the copy stops at log_max_string, as a written string does
+			if( std::strncmp(literals[i], site.literals[literal], log_max_string) == 0 )
+				matching |= 1u << literal;
+			++literal;
+		}
+		return matching;
+	}
+
+	void writer_loop();
+
+	// Hands the pending records of every thread to the sinks, in timestamp order
+	bool drain();
+
+	LogSite m_sites[max_sites];
+	std::atomic<u32> m_site_count { 0 };
+	std::mutex m_sites_mtx;
+
+	std::atomic<u8> m_literal_states[max_sites] {};
+	const char *m_literals[max_literals];
+	std::atomic<u32> m_literal_count { 0 };
+	char m_literal_text[max_literal_text];
+	std::atomic<u32> m_literal_text_size { 0 };
 
-	std::mutex m_mtx;
+	std::vector<LogRing*> m_rings;
+	std::vector<LogRing*> m_drained_rings;
+	std::mutex m_rings_mtx;
+	u32 m_next_thread = 0;
+
+	std::vector<std::unique_ptr<LogSink>> m_sinks;
+	std::mutex m_drain_mtx; // one consumer at a time, protects the sinks
+
+	std::thread m_writer;
+	std::mutex m_writer_mtx;
+	std::condition_variable m_wake_cv;
+	std::condition_variable m_flushed_cv;
+	u64 m_flush_requested = 0;
+	u64 m_flush_done = 0;
+	bool m_running = false;
 };
 
 } // namespace vv
 
 #define VV_LOGGER vv::Logger::get()
 
-#if defined( NDEBUG )
-
-	#define VV_DEBUG(...)
-	#define VV_TRACE(...)
+// Lowest level compiled in, a LogLevel value: 0 for trace up to 5 for fatal.
+// Release builds keep info and above unless the build says otherwise.
+#if !defined( VV_LOG_MIN_LEVEL )
 
-#else
-
-	#define VV_DEBUG(...) vv::Logger::get().log( LogLevel::debug, __VA_ARGS__ )
-	#define VV_TRACE(...) vv::Logger::get().log( LogLevel::trace, __VA_ARGS__ )
+	#if defined( NDEBUG )
+		#define VV_LOG_MIN_LEVEL 2
+	#else
+		#define VV_LOG_MIN_LEVEL 0
+	#endif
 
 #endif
 
-#define VV_INFO(...)  vv::Logger::get().log( LogLevel::info, __VA_ARGS__ )
-#define VV_WARN(...)  vv::Logger::get().log( LogLevel::warn, __VA_ARGS__ )
-#define VV_ERROR(...) vv::Logger::get().log( LogLevel::error, __VA_ARGS__ )
-#define VV_FATAL(...) vv::Logger::get().log( LogLevel::fatal, __VA_ARGS__ )
\ No newline at end of file
+namespace vv
+{
+	constexpr bool log_level_compiled( LogLevel level ) { return static_cast<u32>(level) + 1 > VV_LOG_MIN_LEVEL; }
+}
+
+// `level` must be a constant. Below VV_LOG_MIN_LEVEL the call is discarded at
+// compile time, below Logger::level() it costs one load and a compare.
+#define VV_LOG_AT(level, ...) \
+	do { \
+		if constexpr( vv::log_level_compiled( level ) ) \
+		{ \
+			if( vv::Logger::enabled( level ) ) \
+			{ \
+				static const vv::u32 vv_log_site = vv::Logger::register_site( level, __FILE__, __LINE__ ); \
+				vv::Logger::get().log( vv_log_site, __VA_ARGS__ ); \
+			} \
+		} \
+	} while(0)
+
+#define VV_TRACE(...) VV_LOG_AT( vv::LogLevel::trace, __VA_ARGS__ )
+#define VV_DEBUG(...) VV_LOG_AT( vv::LogLevel::debug, __VA_ARGS__ )
+#define VV_INFO(...)  VV_LOG_AT( vv::LogLevel::info, __VA_ARGS__ )
+#define VV_WARN(...)  VV_LOG_AT( vv::LogLevel::warn, __VA_ARGS__ )
+#define VV_ERROR(...) VV_LOG_AT( vv::LogLevel::error, __VA_ARGS__ )
+#define VV_FATAL(...) VV_LOG_AT( vv::LogLevel::fatal, __VA_ARGS__ )
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "vv_types.hpp"
+#include "log_record.hpp"
+
+#include <cstring>
+
+namespace vv
+{
+
+// Binary log file layout, read back by decode_binary_log (binary_log_reader.hpp).
+// After the file header comes a stream of entries, each starting with its type byte:
+//
+//   site:   'S' | id:u32 | level:u8 | line:u32 | file length:u16 | file
+//           | literal count:u8 | (literal length:u16 | literal) * count
+//   record: 'R' | site:u32 | timestamp:u64 | args size:u32 | args
+//   thread: 'T' | thread:u32 | name length:u16 | name
+//   zone:   'Z' | start:u64 | end:u64 | name length:u16 | name
+//   cause:  'C' | text length:u16 | text
+//
+// A site is written before the first record that uses it, so the format
+// strings (file, line, level, string literals) are stored once and records
+// only carry their raw arguments, encoded as in the logger rings. A site
+// written again replaces the previous one, once its literals are known.
+// Records and zones belong to the thread of the last thread entry, written
+// when the logging thread changes. A zero byte ends the stream. Thread names,
+// zones and the cause only appear in flight recorder dumps.
+//
+// Version 2 had no literals in the sites, and a thread:u32 after the type
+// byte of the records and zones instead of the thread entries.
+namespace binary_log
+{
+	constexpr char magic[4] = { 'V', 'V', 'L', 'G' };
+	constexpr u32 version = 3;
+
+	constexpr unsigned char site_entry = 'S';
+	constexpr unsigned char record_entry = 'R';
+	constexpr unsigned char thread_entry = 'T';
+	constexpr unsigned char zone_entry = 'Z';
+	constexpr unsigned char cause_entry = 'C';
+
+	struct FileHeader
+	{
+		char magic[4];
+		u32 version;
+		u64 steady_start;   // steady clock when the file was opened, nanoseconds
+		u64 system_start;   // system clock at the same time, nanoseconds since the epoch
+	};
+
+	static_assert(sizeof(FileHeader) == 24, "the file header is written as raw bytes");
+
+	inline u16 string_length( const char *str )
+	{
+		std::size_t length = str ? std::strlen(str) : 0;
+		return static_cast<u16>(length < 0xFFFF ? length : 0xFFFF);
+	}
+
+	inline unsigned char *write_bytes( unsigned char *out, const void *data, std::size_t size )
+	{
+		std::memcpy(out, data, size);
+		return out + size;
+	}
+
+	inline unsigned char *write_string( unsigned char *out, const char *str, u16 length )
+	{
+		out = write_bytes(out, &length, 2);
+		return write_bytes(out, str, length);
+	}
+
+	// `literal_count` is 0 until Logger::literals_settled, then LogSite::literal_count
+	inline std::size_t site_entry_size( const LogSite &site, u16 file_length, u32 literal_count )
+	{
+		std::size_t size = 1 + 4 + 1 + 4 + 2 + file_length + 1;
+		for(u32 i = 0; i < literal_count; ++i)
+			size += 2 + string_length(site.literals[i]);
+		return size;
+	}
+
+	inline unsigned char *write_site( unsigned char *out, u32 id, const LogSite &site, u16 file_length, u32 literal_count )
+	{
+		u8 level = static_cast<u8>(site.level);
+		*out++ = site_entry;
+		out = write_bytes(out, &id, 4);
+		*out++ = level;
+		out = write_bytes(out, &site.line, 4);
+		out = write_string(out, site.file, file_length);
+
+		*out++ = static_cast<u8>(literal_count);
+		for(u32 i = 0; i < literal_count; ++i)
+			out = write_string(out, site.literals[i], string_length(site.literals[i]));
+		return out;
+	}
+
+	constexpr std::size_t record_entry_size( u32 args_size ) { return 1 + 4 + 8 + 4 + args_size; }
+
+	inline unsigned char *write_record( unsigned char *out, u32 site, u64 timestamp, const unsigned char *args, u32 args_size )
+	{
+		*out++ = record_entry;
+		out = write_bytes(out, &site, 4);
+		out = write_bytes(out, &timestamp, 8);
+		out = write_bytes(out, &args_size, 4);
+		return write_bytes(out, args, args_size);
+	}
+
+	constexpr std::size_t thread_entry_size( u16 name_length ) { return 1 + 4 + 2 + name_length; }
+
+	inline unsigned char *write_thread( unsigned char *out, u32 thread, const char *name, u16 name_length )
+	{
+		*out++ = thread_entry;
+		out = write_bytes(out, &thread, 4);
+		return write_string(out, name, name_length);
+	}
+}
+
+} // namespace vv
@@ -0,0 +1,174 @@
+#include "binary_log_reader.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace vv;
+
+namespace
+{
+
+class Reader
+{
+public:
+	Reader( const unsigned char *data, std::size_t size ): m_data(data), m_size(size) {}
+
+	bool has( std::size_t size ) const { return m_offset + size <= m_size; }
+
+	template <typename T>
+	T read()
+	{
+		T value;
+		std::memcpy(&value, m_data + m_offset, sizeof(T));
+		m_offset += sizeof(T);
+		return value;
+	}
+
+	const unsigned char *skip( std::size_t size )
+	{
+		const unsigned char *at = m_data + m_offset;
+		m_offset += size;
+		return at;
+	}
+
+	// A u16 length then the bytes, false when the file ends first
+	bool read_string( std::string &out )
+	{
+		if( !has(2) )
+			return false;
+
+		u16 length = read<u16>();
+		if( !has(length) )
+			return false;
+
+		out.assign(reinterpret_cast<const char*>(skip(length)), length);
+		return true;
+	}
+
+	std::size_t offset() const { return m_offset; }
+
+private:
+	const unsigned char *m_data;
+	std::size_t m_size;
+	std::size_t m_offset = 0;
+};
+
+}
+
+bool vv::decode_binary_log( const unsigned char *data, std::size_t size, DecodedLog &log )
+{
+	Reader reader(data, size);
+	if( !reader.has(sizeof(binary_log::FileHeader)) )
+		return false;
+
+	log.header = reader.read<binary_log::FileHeader>();
+	if( std::memcmp(log.header.magic, binary_log::magic, sizeof(log.header.magic)) != 0 || log.header.version == 0 || log.header.version > binary_log::version )
+		return false;
+
+	// version 2 repeats the thread in every record and zone
+	bool inline_threads = log.header.version < 3;
+	u32 thread = 0;
+
+	// a crash leaves the end of the last mapping zeroed: stop at the first zero byte
+	while( reader.has(1) )
+	{
+		unsigned char type = reader.read<unsigned char>();
+
+		if( type == binary_log::site_entry && reader.has(4 + 1 + 4) )
+		{
+			u32 id = reader.read<u32>();
+			u8 level = reader.read<u8>();
+			u32 site_line = reader.read<u32>();
+
+			DecodedLogSite &site = log.sites[id];
+			if( !reader.read_string(site.file) )
+				break;
+
+			site.site.level = static_cast<LogLevel>(level);
+			site.site.line = site_line;
+
+			// a site written again once its literals are known replaces the first one
+			site.literals.clear();
+			if( !inline_threads )
+			{
+				if( !reader.has(1) )
+					break;
+
+				site.literals.resize(reader.read<u8>());
+				bool complete = true;
+				for(std::string &literal: site.literals)
+					complete = complete && reader.read_string(literal);
+				if( !complete )
+					break;
+			}
+
+			site.literal_pointers.clear();
+			for(const std::string &literal: site.literals)
+				site.literal_pointers.push_back(literal.c_str());
+			site.site.literals = site.literal_pointers.data();
+			site.site.literal_count = static_cast<u32>(site.literal_pointers.size());
+		}
+		else if( type == binary_log::record_entry && reader.has((inline_threads ? 4 : 0) + 4 + 8 + 4) )
+		{
+			u32 site_id = reader.read<u32>();
+			if( inline_threads )
+				thread = reader.read<u32>();
+			u64 timestamp = reader.read<u64>();
+			u32 args_size = reader.read<u32>();
+			if( !reader.has(args_size) )
+				break;
+
+			const unsigned char *args = reader.skip(args_size);
+
+			// records logged without a site of their own use the first ids, one per level
+			DecodedLogSite &site = log.sites[site_id];
+			if( site.file.empty() && site_id < log_level_count )
+				site.site.level = static_cast<LogLevel>(site_id);
+			site.site.file = site.file.c_str();
+
+			char line[log_max_line];
+			std::size_t length = format_log_record(site.site, args, args_size, line, sizeof(line));
+			log.events.push_back({ timestamp, thread, site_id, std::string(line, length) });
+		}
+		else if( type == binary_log::thread_entry && reader.has(4) )
+		{
+			// the sinks leave the name empty, the dumps fill it in
+			thread = reader.read<u32>();
+			std::string name;
+			if( !reader.read_string(name) )
+				break;
+			if( !name.empty() )
+				log.thread_names[thread] = name;
+		}
+		else if( type == binary_log::zone_entry && reader.has((inline_threads ? 4 : 0) + 8 + 8) )
+		{
+			if( inline_threads )
+				thread = reader.read<u32>();
+			u64 start = reader.read<u64>();
+			u64 end = reader.read<u64>();
+
+			std::string name;
+			if( !reader.read_string(name) )
+				break;
+
+			char line[128];
+			int length = std::snprintf(line, sizeof(line), "[ZONE ]: %s %.3f ms\n", name.c_str(), static_cast<double>(end - start) * 1e-6);
+			length = std::min<int>(length, sizeof(line) - 1);
+			log.events.push_back({ start, thread, DecodedLog::no_site, std::string(line, length) });
+		}
+		else if( type == binary_log::cause_entry )
+		{
+			if( !reader.read_string(log.cause) )
+				break;
+		}
+		else
+		{
+			if( type != 0 )
+				log.bad_entry = reader.offset() - 1;
+			break;
+		}
+	}
+
+	return true;
+}
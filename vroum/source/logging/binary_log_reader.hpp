@@ -0,0 +1,52 @@
+#pragma once
+
+#include "vv_types.hpp"
+#include "binary_log.hpp"
+#include "log_record.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vv
+{
+
+// A site as read back from a binary log, `site` points in the other members
+struct DecodedLogSite
+{
+	LogSite site;
+	std::string file;
+	std::vector<std::string> literals;
+	std::vector<const char*> literal_pointers;
+};
+
+// A record, formatted as the console prints it, or a zone
+struct DecodedLogEvent
+{
+	u64 timestamp;
+	u32 thread;
+	u32 site; // no_site for a zone
+	std::string text;
+};
+
+struct DecodedLog
+{
+	static constexpr u32 no_site = ~0u;
+
+	binary_log::FileHeader header {};
+	std::string cause;
+	std::unordered_map<u32, std::string> thread_names;
+	std::unordered_map<u32, DecodedLogSite> sites;
+
+	// in file order: sink files are sorted, dumps come one thread after the other
+	std::vector<DecodedLogEvent> events;
+
+	// where decoding stopped on an unknown entry, 0 when the stream ended normally
+	std::size_t bad_entry = 0;
+};
+
+// Reads the files of BinaryLogSink and the flight recorder dumps, older
+// versions included. False when `data` isn't a binary log this build knows
+bool decode_binary_log( const unsigned char *data, std::size_t size, DecodedLog &log );
+
+} // namespace vv
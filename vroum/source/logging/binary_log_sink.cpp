@@ -0,0 +1,180 @@
+#include "binary_log_sink.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if !defined(_WIN32)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+using namespace vv;
+
+BinaryLogSink::BinaryLogSink( const std::string &path ):
+	m_path(path),
+	m_written_sites(Logger::max_sites, site_unwritten)
+{
+#if defined(_WIN32)
+	m_file = std::fopen(path.c_str(), "wb");
+	if( m_file == nullptr )
+	{
+		VV_ERROR("Cannot open the binary log", path);
+		return;
+	}
+
+	m_buffer.resize(growth);
+	m_data = m_buffer.data();
+	m_capacity = m_buffer.size();
+#else
+	m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if( m_fd < 0 || !map(growth) )
+	{
+		VV_ERROR("Cannot open the binary log", path);
+		close();
+		return;
+	}
+#endif
+
+	binary_log::FileHeader header;
+	std::memcpy(header.magic, binary_log::magic, sizeof(header.magic));
+	header.version = binary_log::version;
+	header.steady_start = Logger::now();
+	header.system_start = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	std::memcpy(reserve(sizeof(header)), &header, sizeof(header));
+}
+
+BinaryLogSink::~BinaryLogSink()
+{
+	close();
+}
+
+void BinaryLogSink::write( const LogRecordView &record )
+{
+	if( !is_open() )
+		return;
+
+	if( record.site_id < m_written_sites.size() && m_written_sites[record.site_id] != site_settled )
+	{
+		bool settled = Logger::get().literals_settled(record.site_id);
+		if( settled || m_written_sites[record.site_id] == site_unwritten )
+		{
+			u16 file_length = binary_log::string_length(record.site.file);
+			u32 literal_count = settled ? record.site.literal_count : 0;
+			unsigned char *out = reserve(binary_log::site_entry_size(record.site, file_length, literal_count));
+			if( out == nullptr )
+				return;
+
+			binary_log::write_site(out, record.site_id, record.site, file_length, literal_count);
+			m_written_sites[record.site_id] = settled ? site_settled : site_unsettled;
+		}
+	}
+
+	if( record.thread != m_thread )
+	{
+		unsigned char *out = reserve(binary_log::thread_entry_size(0));
+		if( out == nullptr )
+			return;
+
+		binary_log::write_thread(out, record.thread, "", 0);
+		m_thread = record.thread;
+	}
+
+	unsigned char *out = reserve(binary_log::record_entry_size(record.args_size));
+	if( out == nullptr )
+		return;
+
+	binary_log::write_record(out, record.site_id, record.timestamp, record.args, record.args_size);
+}
+
+void BinaryLogSink::flush()
+{
+#if defined(_WIN32)
+	if( m_file != nullptr )
+	{
+		std::fwrite(m_data, 1, m_offset, m_file);
+		std::fflush(m_file);
+		m_offset = 0;
+	}
+#endif
+	// mapped pages are written back by the kernel, even if the process dies
+}
+
+unsigned char *BinaryLogSink::reserve( u64 size )
+{
+	if( m_offset + size > m_capacity )
+	{
+#if defined(_WIN32)
+		flush();
+		if( size > m_capacity )
+			return nullptr;
+#else
+		u64 capacity = m_capacity + std::max(growth, size);
+		if( !map(capacity) )
+		{
+			VV_ERROR("Cannot grow the binary log", m_path, "closing it");
+			close();
+			return nullptr;
+		}
+#endif
+	}
+
+	unsigned char *out = m_data + m_offset;
+	m_offset += size;
+	m_size += size;
+	return out;
+}
+
+bool BinaryLogSink::map( u64 capacity )
+{
+#if defined(_WIN32)
+	(void)capacity;
+	return false;
+#else
+	if( m_data != nullptr )
+	{
+		munmap(m_data, m_capacity);
+		m_data = nullptr;
+	}
+
+	if( ftruncate(m_fd, static_cast<off_t>(capacity)) != 0 )
+		return false;
+
+	void *data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if( data == MAP_FAILED )
+		return false;
+
+	m_data = static_cast<unsigned char*>(data);
+	m_capacity = capacity;
+	return true;
+#endif
+}
+
+void BinaryLogSink::close()
+{
+#if defined(_WIN32)
+	flush();
+	if( m_file != nullptr )
+		std::fclose(m_file);
+	m_file = nullptr;
+#else
+	if( m_data != nullptr )
+		munmap(m_data, m_capacity);
+
+	// drop the unused end of the last growth, the logger may be gone already: no error to report
+	if( m_fd >= 0 )
+	{
+		int trimmed = ftruncate(m_fd, static_cast<off_t>(m_size));
+		(void)trimmed;
+		::close(m_fd);
+	}
+	m_fd = -1;
+#endif
+
+	m_data = nullptr;
+	m_capacity = 0;
+	m_offset = 0;
+}
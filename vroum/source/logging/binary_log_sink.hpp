@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vv_types.hpp"
+#include "binary_log.hpp"
+#include "log_sink.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace vv
+{
+
+// Appends binary records (see binary_log.hpp) to a memory-mapped file.
+// Writing a record is a copy of its raw bytes in the mapping, the kernel
+// writes the pages back, so what was logged survives a crash of the process.
+class BinaryLogSink: public LogSink
+{
+public:
+	explicit BinaryLogSink( const std::string &path );
+	~BinaryLogSink() override;
+
+	BinaryLogSink( const BinaryLogSink & ) = delete;
+	BinaryLogSink &operator=( const BinaryLogSink & ) = delete;
+
+	bool is_open() const { return m_data != nullptr; }
+
+	void write( const LogRecordView &record ) override;
+	void flush() override;
+
+	// Bytes written so far, header included
+	u64 size() const { return m_size; }
+
+private:
+	static constexpr u64 growth = 8 * 1024 * 1024;
+
+	// Room for `size` more bytes, nullptr when the file can't grow
+	unsigned char *reserve( u64 size );
+	bool map( u64 capacity );
+	void close();
+
+	// sites are written again once their literals are settled
+	static constexpr u8 site_unwritten = 0;
+	static constexpr u8 site_unsettled = 1;
+	static constexpr u8 site_settled = 2;
+
+	std::string m_path;
+	std::vector<u8> m_written_sites;
+	u32 m_thread = ~0u; // of the last record, a thread entry precedes every change
+
+	// the mapped file, or a buffer flushed to m_file where there is no mmap
+	unsigned char *m_data = nullptr;
+	u64 m_capacity = 0;
+	u64 m_offset = 0;
+	u64 m_size = 0;
+
+#if defined(_WIN32)
+	std::vector<unsigned char> m_buffer;
+	std::FILE *m_file = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
+
+} // namespace vv
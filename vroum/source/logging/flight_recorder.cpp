@@ -0,0 +1,407 @@
+#include "flight_recorder.hpp"
+#include "binary_log.hpp"
+#include "logger.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+#if defined(_WIN32)
+	#include <cstdio>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace vv;
+
+namespace
+{
+	struct FlightRing
+	{
+		FlightEvent events[FlightRecorder::ring_capacity];
+		std::atomic<u64> head { 0 };
+		std::atomic<const char*> name { nullptr };
+		u32 index = 0;
+	};
+
+	static_assert((FlightRecorder::ring_capacity & (FlightRecorder::ring_capacity - 1)) == 0, "the ring capacity must be a power of two");
+
+	// rings are never freed: a thread that exited still has its history in the dump
+	std::atomic<FlightRing*> g_rings[FlightRecorder::max_threads];
+	std::atomic<u32> g_ring_count { 0 };
+
+	thread_local FlightRing *t_ring = nullptr;
+	thread_local const char *t_name = nullptr;
+	thread_local bool t_unrecorded = false; // past max_threads
+
+	// filled at init, nothing is allocated once crashing
+	char g_path[512];
+	std::atomic_flag g_dumping = ATOMIC_FLAG_INIT;
+
+	constexpr u32 max_dumped_string = 1024;
+
+	u64 g_zone_clock_ticks = 0;
+	u64 g_zone_clock_nanoseconds = 0;
+	double g_zone_nanoseconds_per_tick = 1.0;
+
+	u64 zone_nanoseconds( u64 ticks )
+	{
+		double elapsed = static_cast<double>(static_cast<i64>(ticks - g_zone_clock_ticks)) * g_zone_nanoseconds_per_tick;
+		return g_zone_clock_nanoseconds + static_cast<i64>(elapsed);
+	}
+
+	// named threads get their ring when named, the others in their first event
+	FlightRing *thread_ring()
+	{
+		if( t_ring != nullptr || t_unrecorded )
+			return t_ring;
+
+		u32 index = g_ring_count.fetch_add(1, std::memory_order_relaxed);
+		if( index >= FlightRecorder::max_threads )
+		{
+			t_unrecorded = true;
+			return nullptr;
+		}
+
+		t_ring = new FlightRing();
+		t_ring->index = index;
+		t_ring->name.store(t_name, std::memory_order_relaxed);
+		g_rings[index].store(t_ring, std::memory_order_release);
+		return t_ring;
+	}
+
+	// Buffered writes with raw file calls only, usable from a signal handler
+	class DumpFile
+	{
+	public:
+		bool open( const char *path )
+		{
+		#if defined(_WIN32)
+			m_file = std::fopen(path, "wb");
+			return m_file != nullptr;
+		#else
+			m_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			return m_fd >= 0;
+		#endif
+		}
+
+		// Room for `size` bytes, nullptr for an entry larger than the buffer
+		unsigned char *reserve( std::size_t size )
+		{
+			if( m_used + size > sizeof(m_buffer) )
+				flush();
+			if( size > sizeof(m_buffer) )
+				return nullptr;
+
+			unsigned char *out = m_buffer + m_used;
+			m_used += size;
+			return out;
+		}
+
+		void flush()
+		{
+		#if defined(_WIN32)
+			std::fwrite(m_buffer, 1, m_used, m_file);
+		#else
+			std::size_t written = 0;
+			while( written < m_used )
+			{
+				ssize_t result = ::write(m_fd, m_buffer + written, m_used - written);
+				if( result <= 0 )
+					break;
+				written += static_cast<std::size_t>(result);
+			}
+		#endif
+			m_used = 0;
+		}
+
+		void close()
+		{
+			flush();
+		#if defined(_WIN32)
+			std::fclose(m_file);
+		#else
+			::close(m_fd);
+		#endif
+		}
+
+	private:
+		unsigned char m_buffer[64 * 1024];
+		std::size_t m_used = 0;
+
+	#if defined(_WIN32)
+		std::FILE *m_file = nullptr;
+	#else
+		int m_fd = -1;
+	#endif
+	};
+
+	DumpFile g_dump_file;
+
+	u16 dumped_length( const char *str )
+	{
+		u16 length = binary_log::string_length(str);
+		return length < max_dumped_string ? length : max_dumped_string;
+	}
+
+	void write_named_entry( unsigned char type, const char *text )
+	{
+		u16 length = dumped_length(text);
+		if( unsigned char *out = g_dump_file.reserve(1 + 2 + length) )
+		{
+			*out++ = type;
+			binary_log::write_string(out, text, length);
+		}
+	}
+
+	void write_ring( const FlightRing &ring )
+	{
+		const char *name = ring.name.load(std::memory_order_relaxed);
+		u16 name_length = dumped_length(name);
+		if( unsigned char *out = g_dump_file.reserve(binary_log::thread_entry_size(name_length)) )
+			binary_log::write_thread(out, ring.index, name, name_length);
+
+		// the oldest slot may be getting overwritten right now, skip it
+		u64 head = ring.head.load(std::memory_order_acquire);
+		u64 first = head > FlightRecorder::ring_capacity ? head - FlightRecorder::ring_capacity + 1 : 0;
+
+		for(u64 i = first; i < head; ++i)
+		{
+			const FlightEvent &event = ring.events[i & (FlightRecorder::ring_capacity - 1)];
+
+			if( event.site == FlightEvent::zone_site )
+			{
+				u16 length = dumped_length(event.name);
+				u64 start = zone_nanoseconds(event.timestamp);
+				u64 end = zone_nanoseconds(event.end);
+				if( unsigned char *out = g_dump_file.reserve(1 + 8 + 8 + 2 + length) )
+				{
+					*out++ = binary_log::zone_entry;
+					out = binary_log::write_bytes(out, &start, 8);
+					out = binary_log::write_bytes(out, &end, 8);
+					binary_log::write_string(out, event.name, length);
+				}
+			}
+			else
+			{
+				u32 args_size = event.args_size <= sizeof(event.args) ? event.args_size : 0;
+				if( unsigned char *out = g_dump_file.reserve(binary_log::record_entry_size(args_size)) )
+					binary_log::write_record(out, event.site, event.timestamp, event.args, args_size);
+			}
+		}
+	}
+
+	struct CrashSignal
+	{
+		int number;
+		const char *name;
+	};
+
+	const CrashSignal g_signals[] = {
+		{ SIGSEGV, "crash: SIGSEGV" },
+		{ SIGFPE,  "crash: SIGFPE" },
+		{ SIGILL,  "crash: SIGILL" },
+		{ SIGABRT, "crash: SIGABRT (abort)" },
+	#if !defined(_WIN32)
+		{ SIGBUS,  "crash: SIGBUS" },
+	#endif
+	};
+
+	constexpr u32 signal_count = sizeof(g_signals) / sizeof(g_signals[0]);
+	bool g_handlers_installed = false;
+
+#if defined(_WIN32)
+	using SignalHandler = void (*)( int );
+	SignalHandler g_previous[signal_count];
+#else
+	struct sigaction g_previous[signal_count];
+
+	// the stack of the thread that overflowed can't run the handler,
+	// only the thread calling init gets this one
+	alignas(16) char g_alternate_stack[64 * 1024];
+#endif
+
+	void restore_handlers()
+	{
+		if( !g_handlers_installed )
+			return;
+
+		for(u32 i = 0; i < signal_count; ++i)
+		{
+		#if defined(_WIN32)
+			std::signal(g_signals[i].number, g_previous[i]);
+		#else
+			sigaction(g_signals[i].number, &g_previous[i], nullptr);
+		#endif
+		}
+		g_handlers_installed = false;
+	}
+
+	void crash_handler( int number )
+	{
+		const char *cause = "crash: unknown signal";
+		for(const CrashSignal &signal: g_signals)
+		{
+			if( signal.number == number )
+				cause = signal.name;
+		}
+
+		FlightRecorder::dump(cause, true);
+
+		// let whoever handled the signal before (or the default action) finish the job
+		restore_handlers();
+		std::raise(number);
+	}
+
+	void install_handlers()
+	{
+		if( g_handlers_installed )
+			return;
+
+	#if defined(_WIN32)
+		for(u32 i = 0; i < signal_count; ++i)
+			g_previous[i] = std::signal(g_signals[i].number, crash_handler);
+	#else
+		stack_t stack {};
+		stack.ss_sp = g_alternate_stack;
+		stack.ss_size = sizeof(g_alternate_stack);
+		sigaltstack(&stack, nullptr);
+
+		struct sigaction action {};
+		action.sa_handler = crash_handler;
+		action.sa_flags = SA_ONSTACK;
+		sigemptyset(&action.sa_mask);
+
+		for(u32 i = 0; i < signal_count; ++i)
+			sigaction(g_signals[i].number, &action, &g_previous[i]);
+	#endif
+
+		g_handlers_installed = true;
+	}
+}
+
+bool FlightRecorder::init( const std::string &path, LogLevel level )
+{
+	if( path.size() >= sizeof(g_path) )
+	{
+		VV_ERROR("Flight recorder path too long", path);
+		return false;
+	}
+
+	std::memcpy(g_path, path.c_str(), path.size() + 1);
+
+	// the site table is read by the dump, it must exist before any crash
+	Logger::get();
+
+	install_handlers();
+	g_min_level.store(static_cast<u32>(level), std::memory_order_relaxed);
+
+	// threads named before init are the calling one, the others start later
+	thread_ring();
+	return true;
+}
+
+void FlightRecorder::shutdown()
+{
+	g_min_level.store(log_level_count, std::memory_order_relaxed);
+	restore_handlers();
+}
+
+void FlightRecorder::set_thread_name( const char *name )
+{
+	t_name = name;
+
+	// allocated now rather than in the thread's first log call
+	if( active() )
+		thread_ring();
+
+	if( t_ring != nullptr )
+		t_ring->name.store(name, std::memory_order_relaxed);
+}
+
+FlightEvent *FlightRecorder::begin_event()
+{
+	if( !active() )
+		return nullptr;
+
+	FlightRing *ring = thread_ring();
+	if( ring == nullptr )
+		return nullptr;
+
+	return &ring->events[ring->head.load(std::memory_order_relaxed) & (ring_capacity - 1)];
+}
+
+void FlightRecorder::end_event()
+{
+	t_ring->head.store(t_ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void FlightRecorder::record_zone( const char *name, u64 start, u64 end )
+{
+	FlightEvent *event = begin_event();
+	if( event == nullptr )
+		return;
+
+	event->timestamp = start;
+	event->end = end;
+	event->name = name;
+	event->site = FlightEvent::zone_site;
+	event->args_size = 0;
+	end_event();
+}
+
+void FlightRecorder::set_zone_clock( u64 ticks, u64 nanoseconds, double nanoseconds_per_tick )
+{
+	g_zone_clock_ticks = ticks;
+	g_zone_clock_nanoseconds = nanoseconds;
+	g_zone_nanoseconds_per_tick = nanoseconds_per_tick;
+}
+
+void FlightRecorder::dump( const char *cause, bool terminal )
+{
+	if( g_path[0] == '\0' )
+		return;
+
+	// one dump at a time, a second crash while dumping just goes on. Stays
+	// set after a terminal dump
+	if( g_dumping.test_and_set(std::memory_order_acquire) )
+		return;
+
+	if( g_dump_file.open(g_path) )
+	{
+		binary_log::FileHeader header;
+		std::memcpy(header.magic, binary_log::magic, sizeof(header.magic));
+		header.version = binary_log::version;
+		header.steady_start = Logger::now();
+		header.system_start = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		if( unsigned char *out = g_dump_file.reserve(sizeof(header)) )
+			std::memcpy(out, &header, sizeof(header));
+
+		write_named_entry(binary_log::cause_entry, cause);
+
+		const Logger &logger = Logger::get();
+		u32 site_count = logger.site_count();
+		for(u32 id = 0; id < site_count; ++id)
+		{
+			const LogSite &site = logger.site(id);
+			u16 length = dumped_length(site.file);
+			u32 literal_count = logger.literals_settled(id) ? site.literal_count : 0;
+			if( unsigned char *out = g_dump_file.reserve(binary_log::site_entry_size(site, length, literal_count)) )
+				binary_log::write_site(out, id, site, length, literal_count);
+		}
+
+		u32 ring_count = g_ring_count.load(std::memory_order_relaxed);
+		for(u32 i = 0; i < ring_count && i < max_threads; ++i)
+		{
+			if( const FlightRing *ring = g_rings[i].load(std::memory_order_acquire) )
+				write_ring(*ring);
+		}
+
+		g_dump_file.close();
+	}
+
+	if( !terminal )
+		g_dumping.clear(std::memory_order_release);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "vv_types.hpp"
+#include "log_record.hpp"
+
+#include <atomic>
+#include <string>
+#include <utility>
+
+namespace vv
+{
+
+// One entry of a flight recorder ring, a log record or a profiler zone.
+// Fixed size so that recording is a copy in the next slot, arguments that
+// don't fit in `args` are dropped.
+struct alignas(64) FlightEvent
+{
+	static constexpr u32 zone_site = ~0u;
+
+	u64 timestamp;     // zones: start, in profiler ticks
+	u64 end;           // zones only, in profiler ticks
+	const char *name;  // zones only, a string that outlives the program
+	u32 site;          // log site, or zone_site
+	u32 args_size;
+	unsigned char args[96];
+};
+
+static_assert(sizeof(FlightEvent) == 128, "flight events should fill two cache lines");
+
+// Crash flight recorder. Every thread keeps its last events in a ring of its
+// own, written without locks, and the rings are dumped to disk in the binary
+// log format (read with vroum_logdecode) on VV_FATAL, on a crash signal or an
+// abort. Records below the sinks level are still recorded down to the
+// recorder level, so a dump has the debug history nobody printed.
+namespace FlightRecorder
+{
+	constexpr u32 ring_capacity = 2048; // events per thread
+	constexpr u32 max_threads = 64;     // later threads are not recorded
+
+	// Starts recording down to `level` and installs the crash handlers,
+	// the dump goes to `path`. The calling thread's ring is allocated now
+	bool init( const std::string &path, LogLevel level );
+
+	// Stops recording and puts back the previous crash handlers
+	void shutdown();
+
+	// lowest level recorded, log_level_count when off
+	inline std::atomic<u32> g_min_level { log_level_count };
+
+	inline bool records( LogLevel level )
+	{
+		return static_cast<u32>(level) >= g_min_level.load(std::memory_order_relaxed);
+	}
+
+	inline bool active()
+	{
+		return g_min_level.load(std::memory_order_relaxed) != log_level_count;
+	}
+
+	// Names the calling thread in the dumps, `name` must outlive the program.
+	// Allocates the thread's ring when recording
+	void set_thread_name( const char *name );
+
+	// Slot for the next event of the calling thread, nullptr when not recording.
+	// Must be followed by end_event().
+	FlightEvent *begin_event();
+	void end_event();
+
+	// `kept_literals` as matched by the logger against the site
+	template <typename ...types>
+	void record( u32 site, u64 timestamp, u32 kept_literals, types&& ...args )
+	{
+		FlightEvent *event = begin_event();
+		if( event == nullptr )
+			return;
+
+		event->timestamp = timestamp;
+		event->site = site;
+		event->args_size = static_cast<u32>(log_args::write_fitting(event->args, event->args + sizeof(event->args), kept_literals, std::forward<types>(args)...) - event->args);
+		end_event();
+	}
+
+	// `start` and `end` in profiler ticks, converted by the dump
+	void record_zone( const char *name, u64 start, u64 end );
+
+	// How the dump turns zone ticks into steady clock nanoseconds, set by
+	// Profiler::init. Ticks are nanoseconds until then
+	void set_zone_clock( u64 ticks, u64 nanoseconds, double nanoseconds_per_tick );
+
+	// Writes every ring to the dump file. Only async-signal-safe calls, can
+	// run in a signal handler. `cause` ends up at the top of the dump.
+	// After a `terminal` dump (a fatal log, a crash) the next ones are skipped:
+	// the abort that usually follows must not overwrite it
+	void dump( const char *cause, bool terminal );
+}
+
+} // namespace vv
@@ -0,0 +1,145 @@
+#include "log_record.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+
+using namespace vv;
+
+const char *vv::log_level_tag( LogLevel level )
+{
+	switch( level )
+	{
+	case LogLevel::trace: return "[TRACE]:";
+	case LogLevel::debug: return "[DEBUG]:";
+	case LogLevel::info:  return "[INFO ]:";
+	case LogLevel::warn:  return "[WARN ]:";
+	case LogLevel::error: return "[ERROR]:";
+	case LogLevel::fatal: return "[FATAL]:";
+	default: return "[?????]:";
+	}
+}
+
+namespace
+{
+	// Appends to a fixed buffer, keeps the last byte for the '\n'
+	class LineWriter
+	{
+	public:
+		LineWriter( char *out, std::size_t capacity ): m_out(out), m_end(out + (capacity > 0 ? capacity - 1 : 0)), m_it(out) {}
+
+		void append( const char *str, std::size_t length )
+		{
+			length = std::min<std::size_t>(length, m_end - m_it);
+			std::memcpy(m_it, str, length);
+			m_it += length;
+		}
+
+		void append( const char *str ) { append(str, std::strlen(str)); }
+		void append( const char *begin, const char *end ) { append(begin, end - begin); }
+
+		void append( char c )
+		{
+			if( m_it < m_end )
+				*m_it++ = c;
+		}
+
+		std::size_t finish()
+		{
+			*m_it++ = '\n';
+			return m_it - m_out;
+		}
+
+	private:
+		char *m_out;
+		char *m_end;
+		char *m_it;
+	};
+}
+
+std::size_t vv::format_log_record( const LogSite &site, const unsigned char *args, std::size_t args_size, char *out, std::size_t capacity )
+{
+	if( capacity == 0 )
+		return 0;
+
+	LineWriter line(out, capacity);
+	line.append(log_level_tag(site.level));
+	line.append(' ');
+
+	const unsigned char *it = args;
+	const unsigned char *end = args + args_size;
+	char number[64];
+
+	while( it < end )
+	{
+		LogArgType type = static_cast<LogArgType>(*it++);
+
+		switch( type )
+		{
+		case LogArgType::signed_int:
+		{
+			i64 value;
+			std::memcpy(&value, it, 8);
+			it += 8;
+			line.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+			break;
+		}
+		case LogArgType::unsigned_int:
+		{
+			u64 value;
+			std::memcpy(&value, it, 8);
+			it += 8;
+			line.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+			break;
+		}
+		case LogArgType::floating:
+		{
+			double value;
+			std::memcpy(&value, it, 8);
+			it += 8;
+			int length = std::snprintf(number, sizeof(number), "%f", value);
+			line.append(number, length > 0 ? std::min<std::size_t>(length, sizeof(number) - 1) : 0);
+			break;
+		}
+		case LogArgType::boolean:
+			line.append(*it++ ? "true" : "false");
+			break;
+		case LogArgType::character:
+			line.append(static_cast<char>(*it++));
+			break;
+		case LogArgType::string:
+		{
+			u16 length;
+			std::memcpy(&length, it, sizeof(length));
+			it += sizeof(length);
+			line.append(reinterpret_cast<const char*>(it), length);
+			it += length;
+			break;
+		}
+		case LogArgType::pointer:
+		{
+			u64 value;
+			std::memcpy(&value, it, 8);
+			it += 8;
+			line.append("0x");
+			line.append(number, std::to_chars(number, number + sizeof(number), value, 16).ptr);
+			break;
+		}
+		case LogArgType::literal:
+		{
+			u8 index = *it++;
+			line.append(index < site.literal_count ? site.literals[index] : "<bad log literal>");
+			break;
+		}
+		default:
+			// corrupted record, drop the rest
+			line.append("<bad log argument>");
+			it = end;
+			break;
+		}
+
+		line.append(' ');
+	}
+
+	return line.finish();
+}
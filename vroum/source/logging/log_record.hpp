@@ -0,0 +1,227 @@
+#pragma once
+
+#include "vv_types.hpp"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace vv
+{
+
+enum class LogLevel: u8
+{
+	trace,
+	debug,
+	info,
+	warn,
+	error,
+	fatal
+};
+
+constexpr u32 log_level_count = 6;
+
+// "[INFO ]:"...
+const char *log_level_tag( LogLevel level );
+
+// What never changes between two calls of the same VV_* line
+struct LogSite
+{
+	LogLevel level = LogLevel::info;
+	const char *file = "";
+	u32 line = 0;
+
+	// string literals of the line, kept by its first call (see Logger::log):
+	// later records only carry their index, a LogArgType::literal
+	const char *const *literals = nullptr;
+	u32 literal_count = 0;
+};
+
+// Every record starts with this header, followed by its encoded arguments.
+// In memory records are padded to 8 bytes, `size` doesn't count the padding.
+struct LogRecordHeader
+{
+	u32 size;      // header included
+	u32 site;
+	u64 timestamp; // steady clock, nanoseconds
+};
+
+static_assert(sizeof(LogRecordHeader) == 16, "log records are written as raw bytes");
+
+constexpr u32 log_record_alignment = 8;
+constexpr u32 log_max_string = 1024; // longer strings are truncated
+constexpr u32 log_max_line = 4096;   // formatted lines are truncated past this, '\n' included
+
+constexpr u32 log_padded_size( u32 size )
+{
+	return (size + log_record_alignment - 1) & ~(log_record_alignment - 1);
+}
+
+enum class LogArgType: u8
+{
+	signed_int,
+	unsigned_int,
+	floating,
+	boolean,
+	character,
+	string,
+	pointer,
+	literal
+};
+
+// Arguments are written as a type byte and a raw payload, strings as a
+// 16 bits length and their bytes, literals as their index in the site.
+// Nothing is formatted at the call site.
+namespace log_args
+{
+	constexpr u32 max_site_literals = 32; // one bit each in a u32 mask
+
+	// String literals and other const char arrays, the site keeps a copy of what
+	// the first call passed. `T` is the forwarded argument type, a mutable char
+	// array is always written in full
+	template <typename T>
+	constexpr bool is_literal = std::is_array_v<std::remove_reference_t<T>>
+		&& std::is_same_v<std::remove_extent_t<std::remove_reference_t<T>>, const char>;
+
+	template <typename T, typename Arg>
+	inline const char *literal_pointer( const Arg &arg )
+	{
+		if constexpr( is_literal<T> )
+			return arg;
+		else
+			return nullptr;
+	}
+
+	inline u32 string_size( std::size_t length )
+	{
+		return 1 + 2 + static_cast<u32>(length < log_max_string ? length : log_max_string);
+	}
+
+	inline u32 size( bool ) { return 2; }
+	inline u32 size( char ) { return 2; }
+	inline u32 size( const char *str ) { return string_size(str ? std::strlen(str) : 0); }
+	inline u32 size( const std::string &str ) { return string_size(str.size()); }
+	inline u32 size( std::string_view str ) { return string_size(str.size()); }
+	inline u32 size( const void * ) { return 9; }
+
+	template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+	inline u32 size( T ) { return 9; }
+
+	inline unsigned char *write_raw( unsigned char *out, LogArgType type, const void *data, std::size_t size )
+	{
+		*out++ = static_cast<unsigned char>(type);
+		std::memcpy(out, data, size);
+		return out + size;
+	}
+
+	inline unsigned char *write_string( unsigned char *out, const char *str, std::size_t length )
+	{
+		u16 clamped = static_cast<u16>(length < log_max_string ? length : log_max_string);
+		*out++ = static_cast<unsigned char>(LogArgType::string);
+		std::memcpy(out, &clamped, sizeof(clamped));
+		std::memcpy(out + sizeof(clamped), str, clamped);
+		return out + sizeof(clamped) + clamped;
+	}
+
+	inline unsigned char *write( unsigned char *out, bool value )
+	{
+		u8 byte = value ? 1 : 0;
+		return write_raw(out, LogArgType::boolean, &byte, 1);
+	}
+
+	inline unsigned char *write( unsigned char *out, char value )
+	{
+		return write_raw(out, LogArgType::character, &value, 1);
+	}
+
+	inline unsigned char *write( unsigned char *out, const char *str )
+	{
+		return str ? write_string(out, str, std::strlen(str)) : write_string(out, "", 0);
+	}
+
+	inline unsigned char *write( unsigned char *out, const std::string &str ) { return write_string(out, str.data(), str.size()); }
+	inline unsigned char *write( unsigned char *out, std::string_view str ) { return write_string(out, str.data(), str.size()); }
+
+	inline unsigned char *write( unsigned char *out, const void *ptr )
+	{
+		u64 value = reinterpret_cast<std::uintptr_t>(ptr);
+		return write_raw(out, LogArgType::pointer, &value, 8);
+	}
+
+	inline unsigned char *write_literal( unsigned char *out, u8 index )
+	{
+		return write_raw(out, LogArgType::literal, &index, 1);
+	}
+
+	template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+	inline unsigned char *write( unsigned char *out, T value )
+	{
+		if constexpr( std::is_enum_v<T> )
+		{
+			return write(out, static_cast<std::underlying_type_t<T>>(value));
+		}
+		else if constexpr( std::is_floating_point_v<T> )
+		{
+			double wide = value;
+			return write_raw(out, LogArgType::floating, &wide, 8);
+		}
+		else if constexpr( std::is_signed_v<T> )
+		{
+			i64 wide = value;
+			return write_raw(out, LogArgType::signed_int, &wide, 8);
+		}
+		else
+		{
+			u64 wide = value;
+			return write_raw(out, LogArgType::unsigned_int, &wide, 8);
+		}
+	}
+
+	// An argument of a call, as an index when the site's copy of that literal
+	// matches: bit i of `kept` for the i-th literal argument. `literal` counts
+	// the literals seen so far
+	template <typename T, typename Arg>
+	inline u32 site_size( const Arg &arg, u32 kept, u8 &literal )
+	{
+		if constexpr( is_literal<T> )
+		{
+			if( kept & (1u << literal++) )
+				return 2;
+		}
+		return size(arg);
+	}
+
+	template <typename T, typename Arg>
+	inline unsigned char *site_write( unsigned char *out, const Arg &arg, u32 kept, u8 &literal )
+	{
+		if constexpr( is_literal<T> )
+		{
+			u8 index = literal++;
+			if( kept & (1u << index) )
+				return write_literal(out, index);
+		}
+		return write(out, arg);
+	}
+
+	// Encodes the leading arguments that fit before `end`, drops the rest
+	template <typename ...types>
+	inline unsigned char *write_fitting( unsigned char *out, const unsigned char *end, u32 kept, types&& ...args )
+	{
+		bool fits = true;
+		u8 sized = 0;
+		u8 written = 0;
+		((fits = fits && site_size<types>(args, kept, sized) <= static_cast<std::size_t>(end - out),
+			out = fits ? site_write<types>(out, args, kept, written) : out), ...);
+		(void)fits;
+		(void)end;
+		return out;
+	}
+}
+
+// Writes the text of one record to `out`: the level tag then every argument
+// followed by a space, the line the logger always printed. Never allocates,
+// the line is cut to `capacity` but always ends with '\n'. Returns its length.
+std::size_t format_log_record( const LogSite &site, const unsigned char *args, std::size_t args_size, char *out, std::size_t capacity );
+
+} // namespace vv
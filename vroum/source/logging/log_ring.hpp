@@ -0,0 +1,108 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "log_record.hpp"
+#include "threading/wait_strategy.hpp"
+
+#include <atomic>
+
+namespace vv
+{
+
+// Single-producer / single-consumer ring of variable sized log records, one
+// per logging thread. A record is always contiguous: when it doesn't fit
+// before the end of the buffer, the end is skipped with a padding record.
+class LogRing
+{
+public:
+	static constexpr u32 capacity = 64 * 1024;
+	static constexpr u32 max_record_size = capacity / 4;
+	static constexpr u32 padding_site = ~0u;
+
+	static_assert((capacity & (capacity - 1)) == 0, "LogRing capacity must be a power of two");
+
+	explicit LogRing( u32 thread_index ): m_thread_index(thread_index) {}
+
+	LogRing( const LogRing & ) = delete;
+	LogRing &operator=( const LogRing & ) = delete;
+
+	u32 thread_index() const { return m_thread_index; }
+
+	// Producer side
+
+	// Contiguous room for `size` bytes (padded with log_padded_size), nullptr when full
+	unsigned char *try_reserve( u32 size )
+	{
+		u64 head = m_head.load(std::memory_order_relaxed);
+		u32 offset = static_cast<u32>(head & (capacity - 1));
+		u32 padding = offset + size > capacity ? capacity - offset : 0;
+
+		if( !has_room(head, padding + size) )
+			return nullptr;
+
+		if( padding > 0 )
+		{
+			// only size and site: the padding can be as small as 8 bytes
+			u32 pad[2] = { padding, padding_site };
+			std::memcpy(m_buffer + offset, pad, sizeof(pad));
+			head += padding;
+			m_head.store(head, std::memory_order_release);
+		}
+
+		return m_buffer + (head & (capacity - 1));
+	}
+
+	void commit( u32 size )
+	{
+		m_head.store(m_head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+	}
+
+	// The owning thread exited, the ring can go once it is empty
+	void close() { m_closed.store(true, std::memory_order_release); }
+
+	// Consumer side
+
+	// Next record, nullptr when empty
+	const LogRecordHeader *peek()
+	{
+		for(;;)
+		{
+			u64 tail = m_tail.load(std::memory_order_relaxed);
+			if( tail == m_head.load(std::memory_order_acquire) )
+				return nullptr;
+
+			auto *header = reinterpret_cast<const LogRecordHeader*>(m_buffer + (tail & (capacity - 1)));
+			if( header->site != padding_site )
+				return header;
+
+			m_tail.store(tail + header->size, std::memory_order_release);
+		}
+	}
+
+	void pop( const LogRecordHeader *header )
+	{
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + log_padded_size(header->size), std::memory_order_release);
+	}
+
+	bool closed() const { return m_closed.load(std::memory_order_acquire); }
+
+private:
+	bool has_room( u64 head, u32 size )
+	{
+		if( capacity - (head - m_cached_tail) >= size )
+			return true;
+
+		m_cached_tail = m_tail.load(std::memory_order_acquire);
+		return capacity - (head - m_cached_tail) >= size;
+	}
+
+	alignas(cache_line_size) std::atomic<u64> m_head { 0 };
+	u64 m_cached_tail = 0; // producer's view of m_tail
+	alignas(cache_line_size) std::atomic<u64> m_tail { 0 };
+	std::atomic<bool> m_closed { false };
+	u32 m_thread_index;
+
+	alignas(cache_line_size) unsigned char m_buffer[capacity];
+};
+
+} // namespace vv
@@ -0,0 +1,15 @@
+#include "log_sink.hpp"
+
+using namespace vv;
+
+void ConsoleSink::write( const LogRecordView &record )
+{
+	char line[log_max_line];
+	std::size_t length = format_log_record(record.site, record.args, record.args_size, line, sizeof(line));
+	std::fwrite(line, 1, length, m_stream);
+}
+
+void ConsoleSink::flush()
+{
+	std::fflush(m_stream);
+}
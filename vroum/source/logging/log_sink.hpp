@@ -0,0 +1,48 @@
+#pragma once
+
+#include "vv_types.hpp"
+#include "log_record.hpp"
+
+#include <cstdio>
+
+namespace vv
+{
+
+// One record as the logger thread hands it to the sinks
+struct LogRecordView
+{
+	const LogSite &site;
+	u32 site_id;
+	u32 thread;       // index of the thread that logged it
+	u64 timestamp;    // steady clock, nanoseconds
+	const unsigned char *args;
+	u32 args_size;
+};
+
+// Where the records end up. Sinks are only called from the logger thread
+// (or under its lock when flushing synchronously), they don't need to be thread safe.
+class LogSink
+{
+public:
+	virtual ~LogSink() = default;
+
+	virtual void write( const LogRecordView &record ) = 0;
+
+	// Called after each batch of records
+	virtual void flush() {}
+};
+
+// Text lines on a stdio stream, stdout by default
+class ConsoleSink: public LogSink
+{
+public:
+	explicit ConsoleSink( std::FILE *stream = stdout ): m_stream(stream) {}
+
+	void write( const LogRecordView &record ) override;
+	void flush() override;
+
+private:
+	std::FILE *m_stream;
+};
+
+} // namespace vv
@@ -0,0 +1,315 @@
+#include "alloc_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+using namespace vv;
+
+#ifdef VV_ALLOC_PROFILER
+
+#if defined(__GLIBC__)
+	// glibc exports its allocator under these names, so malloc can be
+	// replaced here without having to find the real one with dlsym
+	extern "C"
+	{
+		void *__libc_malloc( std::size_t size );
+		void *__libc_calloc( std::size_t count, std::size_t size );
+		void *__libc_realloc( void *ptr, std::size_t size );
+		void *__libc_memalign( std::size_t alignment, std::size_t size );
+		void __libc_free( void *ptr );
+	}
+	#define VV_HOOK_MALLOC
+#endif
+
+#if defined(__GNUC__)
+	// the hooks run inside malloc: the TLS must not be allocated lazily
+	#define VV_INITIAL_EXEC_TLS __attribute__((tls_model("initial-exec")))
+#else
+	#define VV_INITIAL_EXEC_TLS
+#endif
+
+namespace
+{
+	constexpr u32 max_threads = AllocFrameReport::max_threads;
+	constexpr u32 max_tags = AllocFrameReport::max_tags;
+	constexpr u32 source_count = AllocFrameReport::source_count;
+
+	struct Counter
+	{
+		std::atomic<u64> count;
+		std::atomic<u64> bytes;
+	};
+
+	// static storage is zeroed before anything runs, even allocations made by other static constructors
+	Counter g_counters[max_threads][max_tags][source_count];
+	std::atomic<u32> g_thread_count;
+	std::atomic<u32> g_tag_count;
+	const char *g_tag_names[max_tags];
+	const char *g_thread_names[max_threads];
+	std::mutex g_tag_mutex;
+
+	AllocCounters g_previous[max_threads][max_tags][source_count];
+	AllocFrameReport g_report;
+
+	thread_local u32 t_thread_slot VV_INITIAL_EXEC_TLS = 0; // index + 1, 0 before the first allocation
+	thread_local u32 t_tag VV_INITIAL_EXEC_TLS = 0;
+
+	u32 thread_slot()
+	{
+		if( t_thread_slot == 0 )
+		{
+			// threads past the limit share the last slot
+			u32 slot = g_thread_count.fetch_add(1, std::memory_order_relaxed);
+			t_thread_slot = (slot < max_threads ? slot : max_threads - 1) + 1;
+		}
+
+		return t_thread_slot - 1;
+	}
+
+	void record( AllocSource source, std::size_t size )
+	{
+		Counter &counter = g_counters[thread_slot()][t_tag][static_cast<u32>(source)];
+		counter.count.fetch_add(1, std::memory_order_relaxed);
+		counter.bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void *raw_malloc( std::size_t size )
+	{
+	#ifdef VV_HOOK_MALLOC
+		return __libc_malloc(size);
+	#else
+		return std::malloc(size);
+	#endif
+	}
+
+	void raw_free( void *ptr )
+	{
+	#ifdef VV_HOOK_MALLOC
+		__libc_free(ptr);
+	#else
+		std::free(ptr);
+	#endif
+	}
+
+	void *raw_aligned_malloc( std::size_t size, std::size_t alignment )
+	{
+	#if defined(VV_HOOK_MALLOC)
+		return __libc_memalign(alignment, size);
+	#elif defined(_MSC_VER)
+		return _aligned_malloc(size, alignment);
+	#else
+		return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+	#endif
+	}
+
+	void raw_aligned_free( void *ptr )
+	{
+	#if defined(_MSC_VER)
+		_aligned_free(ptr);
+	#else
+		raw_free(ptr);
+	#endif
+	}
+
+	void *profiled_new( std::size_t size )
+	{
+		void *ptr = raw_malloc(size == 0 ? 1 : size);
+		if( ptr == nullptr )
+			throw std::bad_alloc();
+
+		record(AllocSource::cpp_new, size);
+		return ptr;
+	}
+
+	void *profiled_aligned_new( std::size_t size, std::align_val_t alignment )
+	{
+		void *ptr = raw_aligned_malloc(size == 0 ? 1 : size, static_cast<std::size_t>(alignment));
+		if( ptr == nullptr )
+			throw std::bad_alloc();
+
+		record(AllocSource::cpp_new, size);
+		return ptr;
+	}
+}
+
+void *operator new( std::size_t size ) { return profiled_new(size); }
+void *operator new[]( std::size_t size ) { return profiled_new(size); }
+void *operator new( std::size_t size, std::align_val_t alignment ) { return profiled_aligned_new(size, alignment); }
+void *operator new[]( std::size_t size, std::align_val_t alignment ) { return profiled_aligned_new(size, alignment); }
+
+void *operator new( std::size_t size, const std::nothrow_t & ) noexcept
+{
+	try { return profiled_new(size); } catch( ... ) { return nullptr; }
+}
+
+void *operator new[]( std::size_t size, const std::nothrow_t & ) noexcept
+{
+	try { return profiled_new(size); } catch( ... ) { return nullptr; }
+}
+
+void *operator new( std::size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept
+{
+	try { return profiled_aligned_new(size, alignment); } catch( ... ) { return nullptr; }
+}
+
+void *operator new[]( std::size_t size, std::align_val_t alignment, const std::nothrow_t & ) noexcept
+{
+	try { return profiled_aligned_new(size, alignment); } catch( ... ) { return nullptr; }
+}
+
+void operator delete( void *ptr ) noexcept { raw_free(ptr); }
+void operator delete[]( void *ptr ) noexcept { raw_free(ptr); }
+void operator delete( void *ptr, std::size_t ) noexcept { raw_free(ptr); }
+void operator delete[]( void *ptr, std::size_t ) noexcept { raw_free(ptr); }
+void operator delete( void *ptr, const std::nothrow_t & ) noexcept { raw_free(ptr); }
+void operator delete[]( void *ptr, const std::nothrow_t & ) noexcept { raw_free(ptr); }
+void operator delete( void *ptr, std::align_val_t ) noexcept { raw_aligned_free(ptr); }
+void operator delete[]( void *ptr, std::align_val_t ) noexcept { raw_aligned_free(ptr); }
+void operator delete( void *ptr, std::size_t, std::align_val_t ) noexcept { raw_aligned_free(ptr); }
+void operator delete[]( void *ptr, std::size_t, std::align_val_t ) noexcept { raw_aligned_free(ptr); }
+void operator delete( void *ptr, std::align_val_t, const std::nothrow_t & ) noexcept { raw_aligned_free(ptr); }
+void operator delete[]( void *ptr, std::align_val_t, const std::nothrow_t & ) noexcept { raw_aligned_free(ptr); }
+
+#ifdef VV_HOOK_MALLOC
+extern "C"
+{
+	void *malloc( std::size_t size ) noexcept
+	{
+		record(AllocSource::malloc, size);
+		return __libc_malloc(size);
+	}
+
+	void *calloc( std::size_t count, std::size_t size ) noexcept
+	{
+		record(AllocSource::malloc, count * size);
+		return __libc_calloc(count, size);
+	}
+
+	void *realloc( void *ptr, std::size_t size ) noexcept
+	{
+		record(AllocSource::malloc, size);
+		return __libc_realloc(ptr, size);
+	}
+}
+#endif
+
+u32 AllocProfiler::register_tag( const char *name )
+{
+	std::lock_guard<std::mutex> lock(g_tag_mutex);
+
+	u32 count = g_tag_count.load(std::memory_order_relaxed);
+	for(u32 tag = 1; tag < count; ++tag)
+	{
+		if( std::strcmp(g_tag_names[tag], name) == 0 )
+			return tag;
+	}
+
+	// out of tags, count it as untagged
+	if( std::max(count, 1u) >= max_tags )
+		return 0;
+
+	u32 tag = std::max(count, 1u);
+	g_tag_names[tag] = name;
+	g_tag_count.store(tag + 1, std::memory_order_release);
+	return tag;
+}
+
+const char *AllocProfiler::tag_name( u32 tag )
+{
+	if( tag == 0 || tag >= g_tag_count.load(std::memory_order_acquire) )
+		return "untagged";
+	return g_tag_names[tag];
+}
+
+void AllocProfiler::set_thread_name( const char *name )
+{
+	g_thread_names[thread_slot()] = name;
+}
+
+const char *AllocProfiler::thread_name( u32 thread )
+{
+	if( thread >= max_threads || g_thread_names[thread] == nullptr )
+		return "unnamed thread";
+	return g_thread_names[thread];
+}
+
+u32 AllocProfiler::set_current_tag( u32 tag )
+{
+	u32 previous = t_tag;
+	t_tag = tag < max_tags ? tag : 0;
+	return previous;
+}
+
+const AllocFrameReport &AllocProfiler::end_frame()
+{
+	g_report = AllocFrameReport();
+
+	u32 thread_count = std::min(g_thread_count.load(std::memory_order_relaxed), max_threads);
+	u32 tag_count = std::max(g_tag_count.load(std::memory_order_acquire), 1u);
+
+	for(u32 thread = 0; thread < thread_count; ++thread)
+	for(u32 tag = 0; tag < tag_count; ++tag)
+	for(u32 source = 0; source < source_count; ++source)
+	{
+		Counter &counter = g_counters[thread][tag][source];
+		AllocCounters &previous = g_previous[thread][tag][source];
+
+		u64 count = counter.count.load(std::memory_order_relaxed);
+		u64 bytes = counter.bytes.load(std::memory_order_relaxed);
+		u64 new_count = count - previous.count;
+		u64 new_bytes = bytes - previous.bytes;
+		previous.count = count;
+		previous.bytes = bytes;
+
+		g_report.total[source].count += new_count;
+		g_report.total[source].bytes += new_bytes;
+		g_report.threads[thread][source].count += new_count;
+		g_report.threads[thread][source].bytes += new_bytes;
+		g_report.tags[tag][source].count += new_count;
+		g_report.tags[tag][source].bytes += new_bytes;
+	}
+
+	return g_report;
+}
+
+#else // VV_ALLOC_PROFILER
+
+u32 AllocProfiler::register_tag( const char * ) { return 0; }
+const char *AllocProfiler::tag_name( u32 ) { return "untagged"; }
+void AllocProfiler::set_thread_name( const char * ) {}
+const char *AllocProfiler::thread_name( u32 ) { return "unnamed thread"; }
+u32 AllocProfiler::set_current_tag( u32 ) { return 0; }
+
+const AllocFrameReport &AllocProfiler::end_frame()
+{
+	static const AllocFrameReport empty;
+	return empty;
+}
+
+#endif // VV_ALLOC_PROFILER
+
+void AllocProfiler::log_report( const AllocFrameReport &report, const char *title )
+{
+	const AllocCounters &cpp = report[AllocSource::cpp_new];
+	const AllocCounters &c = report[AllocSource::malloc];
+
+	VV_WARN(title, "-", cpp.count, "new (", cpp.bytes, "bytes),", c.count, "malloc (", c.bytes, "bytes)");
+
+	for(u32 thread = 0; thread < AllocFrameReport::max_threads; ++thread)
+	{
+		const AllocCounters *counters = report.threads[thread];
+		if( counters[0].count + counters[1].count > 0 )
+			VV_WARN("  thread", thread_name(thread), ":", counters[0].count, "new,", counters[1].count, "malloc");
+	}
+
+	for(u32 tag = 0; tag < AllocFrameReport::max_tags; ++tag)
+	{
+		const AllocCounters *counters = report.tags[tag];
+		if( counters[0].count + counters[1].count > 0 )
+			VV_WARN("  tag", tag_name(tag), ":", counters[0].count, "new,", counters[1].count, "malloc");
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+#include <cstddef>
+
+namespace vv
+{
+
+// Allocation profiler, compiled in with the VROUM_ALLOC_PROFILER CMake option.
+// It replaces the global operator new (and malloc on glibc) to count the
+// allocations of every thread, under the tag of the innermost VV_ALLOC_SCOPE.
+// Without the option every function here is a no-op.
+
+enum class AllocSource: u8
+{
+	cpp_new = 0, // operator new
+	malloc,      // malloc, calloc, realloc: drivers, SDL...
+	count
+};
+
+struct AllocCounters
+{
+	u64 count = 0;
+	u64 bytes = 0;
+};
+
+struct AllocFrameReport
+{
+	static constexpr u32 max_threads = 64;
+	static constexpr u32 max_tags = 32;
+	static constexpr u32 source_count = static_cast<u32>(AllocSource::count);
+
+	AllocCounters total[source_count];
+	AllocCounters threads[max_threads][source_count];
+	AllocCounters tags[max_tags][source_count];
+
+	const AllocCounters &operator[]( AllocSource source ) const { return total[static_cast<u32>(source)]; }
+};
+
+namespace AllocProfiler
+{
+#ifdef VV_ALLOC_PROFILER
+	constexpr bool enabled = true;
+#else
+	constexpr bool enabled = false;
+#endif
+
+	// Tag 0 is "untagged". Names must outlive the profiler, string literals are fine
+	u32 register_tag( const char *name );
+	const char *tag_name( u32 tag );
+
+	// Names the calling thread in the reports
+	void set_thread_name( const char *name );
+	const char *thread_name( u32 thread );
+
+	// Tag of the calling thread's allocations, returns the previous one
+	u32 set_current_tag( u32 tag );
+
+	// Counts since the previous call: call it once per frame, from one thread
+	const AllocFrameReport &end_frame();
+
+	// Logs every thread and tag that allocated in `report`
+	void log_report( const AllocFrameReport &report, const char *title );
+}
+
+// Tags the allocations of the calling thread until the end of the scope
+class AllocScope
+{
+public:
+	explicit AllocScope( u32 tag ): m_previous(AllocProfiler::set_current_tag(tag)) {}
+	~AllocScope() { AllocProfiler::set_current_tag(m_previous); }
+
+	AllocScope( const AllocScope & ) = delete;
+	AllocScope &operator=( const AllocScope & ) = delete;
+
+private:
+	u32 m_previous;
+};
+
+} // namespace vv
+
+#ifdef VV_ALLOC_PROFILER
+	#define VV_ALLOC_CONCAT_IMPL(a, b) a##b
+	#define VV_ALLOC_CONCAT(a, b) VV_ALLOC_CONCAT_IMPL(a, b)
+	#define VV_ALLOC_SCOPE(name) \
+		static const vv::u32 VV_ALLOC_CONCAT(vv_alloc_tag_, __LINE__) = vv::AllocProfiler::register_tag(name); \
+		vv::AllocScope VV_ALLOC_CONCAT(vv_alloc_scope_, __LINE__)( VV_ALLOC_CONCAT(vv_alloc_tag_, __LINE__) )
+#else
+	#define VV_ALLOC_SCOPE(name)
+#endif
@@ -0,0 +1,61 @@
+#include "frame_arena.hpp"
+#include "threading/job_system.hpp"
+
+#include <cstdlib>
+
+using namespace vv;
+
+void FrameArena::init( u32 thread_count, u32 buffer_count )
+{
+	assert( thread_count > 0 );
+	assert( buffer_count > 0 && buffer_count <= max_buffers );
+
+	m_thread_count = thread_count;
+	m_buffer_count = buffer_count;
+	m_buffer = 0;
+
+	m_arenas.clear();
+	m_arenas.resize(thread_count * buffer_count);
+}
+
+void FrameArena::begin_frame()
+{
+	m_buffer = (m_buffer + 1) % m_buffer_count;
+
+	for(u32 i = 0; i < m_thread_count; ++i)
+		m_arenas[m_buffer * m_thread_count + i].arena.reset();
+}
+
+FrameArena::ThreadArena &FrameArena::current()
+{
+	u32 thread = JobSystem::thread_index();
+	if( thread >= m_thread_count )
+	{
+		// each arena belongs to one thread of the job system, sharing one would race
+		VV_FATAL("Frame arena allocation from a thread outside the job system");
+		std::abort();
+	}
+
+	return m_arenas[m_buffer * m_thread_count + thread];
+}
+
+void *FrameArena::allocate( std::size_t size, std::size_t alignment )
+{
+	return current().arena.allocate(size, alignment);
+}
+
+std::size_t FrameArena::used() const
+{
+	std::size_t total = 0;
+	for(u32 i = 0; i < m_thread_count; ++i)
+		total += m_arenas[m_buffer * m_thread_count + i].arena.used();
+	return total;
+}
+
+std::size_t FrameArena::capacity() const
+{
+	std::size_t total = 0;
+	for(const ThreadArena &thread: m_arenas)
+		total += thread.arena.capacity();
+	return total;
+}
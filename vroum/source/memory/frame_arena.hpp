@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "linear_arena.hpp"
+#include "threading/wait_strategy.hpp"
+
+#include <vector>
+
+namespace vv
+{
+
+// Scratch memory for the current frame. Each thread of the job system bumps
+// in its own LinearArena, so allocating never takes a lock. The arenas are
+// buffered: memory allocated during frame N stays valid until frame
+// N + buffer_count starts, long enough for the render thread to consume it.
+class FrameArena
+{
+public:
+	static constexpr u32 max_buffers = 3;
+
+	// `thread_count` threads of the job system, `buffer_count` frames kept alive
+	void init( u32 thread_count, u32 buffer_count = 2 );
+
+	// Moves to the next buffer and rewinds it, call it while no job runs
+	void begin_frame();
+
+	// Only from the threads of the job system, aborts on any other thread
+	void *allocate( std::size_t size, std::size_t alignment = alignof(std::max_align_t) );
+
+	template <typename T>
+	T *allocate_array( std::size_t count )
+	{
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Bytes allocated this frame, by every thread
+	std::size_t used() const;
+
+	// Bytes reserved by every buffer
+	std::size_t capacity() const;
+
+	u32 buffer_count() const { return m_buffer_count; }
+
+private:
+	struct alignas(cache_line_size) ThreadArena
+	{
+		LinearArena arena;
+	};
+
+	ThreadArena &current();
+
+	std::vector<ThreadArena> m_arenas; // buffer major
+	u32 m_thread_count = 0;
+	u32 m_buffer_count = 0;
+	u32 m_buffer = 0;
+};
+
+// std::vector<T, FrameAllocator<T>> lives until the frame arena wraps around
+template <typename T>
+using FrameAllocator = ArenaAllocator<T, FrameArena>;
+
+} // namespace vv
@@ -0,0 +1,55 @@
+#include "linear_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace vv;
+
+void *LinearArena::allocate( std::size_t size, std::size_t alignment )
+{
+	assert( alignment != 0 && (alignment & (alignment - 1)) == 0 );
+
+	// bump in the current block, or move on to the next one big enough
+	while( m_block_index < m_blocks.size() )
+	{
+		Block &block = m_blocks[m_block_index];
+		std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.data.get());
+		std::size_t offset = ((base + m_block_offset + alignment - 1) & ~(alignment - 1)) - base;
+
+		if( offset + size <= block.size )
+		{
+			m_block_offset = offset + size;
+			m_used += size;
+			return block.data.get() + offset;
+		}
+
+		++m_block_index;
+		m_block_offset = 0;
+	}
+
+	// blocks are kept across resets, this only happens until the steady state
+	Block block;
+	block.size = std::max(m_block_size, size + alignment);
+	block.data = std::make_unique<unsigned char[]>(block.size);
+	m_blocks.push_back(std::move(block));
+
+	m_block_index = m_blocks.size() - 1;
+	m_block_offset = 0;
+
+	return allocate(size, alignment);
+}
+
+void LinearArena::reset()
+{
+	m_block_index = 0;
+	m_block_offset = 0;
+	m_used = 0;
+}
+
+std::size_t LinearArena::capacity() const
+{
+	std::size_t total = 0;
+	for(const Block &block: m_blocks)
+		total += block.size;
+	return total;
+}
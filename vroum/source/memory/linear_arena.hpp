@@ -0,0 +1,112 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace vv
+{
+
+// Bump allocator over a list of blocks. reset() rewinds it without freeing
+// anything, so once the blocks cover the peak usage allocating is a pointer
+// increment. Nothing is freed individually and destructors never run.
+// Not thread safe.
+class LinearArena
+{
+public:
+	static constexpr std::size_t default_block_size = 64 * 1024;
+
+	explicit LinearArena( std::size_t block_size = default_block_size ):
+		m_block_size(block_size)
+	{
+	}
+
+	LinearArena( const LinearArena & ) = delete;
+	LinearArena &operator=( const LinearArena & ) = delete;
+
+	LinearArena( LinearArena && ) = default;
+	LinearArena &operator=( LinearArena && ) = default;
+
+	// Memory valid until the next reset, `alignment` must be a power of two
+	void *allocate( std::size_t size, std::size_t alignment = alignof(std::max_align_t) );
+
+	// Uninitialized storage for `count` objects
+	template <typename T>
+	T *allocate_array( std::size_t count )
+	{
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	template <typename T, typename ...Args>
+	T *create( Args &&...args )
+	{
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// Forget every allocation but keep the blocks
+	void reset();
+
+	// Bytes handed out since the last reset
+	std::size_t used() const { return m_used; }
+
+	// Bytes reserved by the blocks
+	std::size_t capacity() const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<unsigned char[]> data;
+		std::size_t size = 0;
+	};
+
+	std::vector<Block> m_blocks;
+	std::size_t m_block_size;
+	std::size_t m_block_index = 0;
+	std::size_t m_block_offset = 0;
+	std::size_t m_used = 0;
+};
+
+// Standard allocator over an arena, for containers that only live as long
+// as the arena allocations do. `Arena` needs allocate(size, alignment).
+template <typename T, typename Arena = LinearArena>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	ArenaAllocator( Arena &arena ) noexcept:
+		m_arena(&arena)
+	{
+	}
+
+	template <typename U>
+	ArenaAllocator( const ArenaAllocator<U, Arena> &other ) noexcept:
+		m_arena(other.arena())
+	{
+	}
+
+	T *allocate( std::size_t count )
+	{
+		return static_cast<T*>(m_arena->allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// freed all at once when the arena is reset
+	void deallocate( T *, std::size_t ) noexcept {}
+
+	Arena *arena() const { return m_arena; }
+
+	template <typename U>
+	bool operator==( const ArenaAllocator<U, Arena> &other ) const { return m_arena == other.arena(); }
+
+	template <typename U>
+	bool operator!=( const ArenaAllocator<U, Arena> &other ) const { return m_arena != other.arena(); }
+
+private:
+	Arena *m_arena;
+};
+
+} // namespace vv
@@ -0,0 +1,179 @@
+#include "frame_stats.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+using namespace vv;
+
+static constexpr u32 metric_count = static_cast<u32>(FrameMetric::count);
+static constexpr u32 counter_count = static_cast<u32>(FrameCounter::count);
+
+const char *vv::to_string( FrameMetric metric )
+{
+	switch( metric )
+	{
+	case FrameMetric::frame: return "frame";
+	case FrameMetric::update: return "update";
+	case FrameMetric::submit: return "submit";
+	case FrameMetric::render: return "render";
+	case FrameMetric::gpu: return "gpu";
+	default: return "unknown";
+	}
+}
+
+const char *vv::to_string( FrameCounter counter )
+{
+	switch( counter )
+	{
+	case FrameCounter::draws: return "draws";
+	case FrameCounter::state_changes: return "state changes";
+	case FrameCounter::bytes_uploaded: return "bytes uploaded";
+	default: return "unknown";
+	}
+}
+
+void FrameStats::init( u32 history_frames )
+{
+	m_samples.assign(std::max(history_frames, 1u), FrameSample());
+	m_scratch.resize(m_samples.size());
+	m_next = 0;
+	m_count = 0;
+}
+
+void FrameStats::push( const FrameSample &sample )
+{
+	if( m_samples.empty() )
+		return;
+
+	m_samples[m_next] = sample;
+	m_next = (m_next + 1) % capacity();
+	m_count = std::min(m_count + 1, capacity());
+}
+
+const FrameSample &FrameStats::sample( u32 age ) const
+{
+	return m_samples[(m_next + capacity() - 1 - age) % capacity()];
+}
+
+StatSummary vv::summarize_values( double *values, u32 count )
+{
+	StatSummary summary;
+	if( count == 0 )
+		return summary;
+
+	std::sort(values, values + count);
+
+	double total = 0.0;
+	for(u32 i = 0; i < count; ++i)
+		total += values[i];
+
+	auto percentile = [values, count]( u32 percent ) {
+		u32 rank = (percent * count + 99) / 100; // nearest rank, 1 based
+		return values[std::max(rank, 1u) - 1];
+	};
+
+	summary.min = values[0];
+	summary.avg = total / count;
+	summary.p50 = percentile(50);
+	summary.p95 = percentile(95);
+	summary.p99 = percentile(99);
+	summary.max = values[count - 1];
+	return summary;
+}
+
+FrameStatsSummary FrameStats::summarize( u32 window_frames ) const
+{
+	FrameStatsSummary summary;
+	summary.frame_count = std::min(window_frames, m_count);
+
+	for(u32 metric = 0; metric < metric_count; ++metric)
+	{
+		for(u32 age = 0; age < summary.frame_count; ++age)
+			m_scratch[age] = sample(age).times_ms[metric];
+		summary.times[metric] = summarize_values(m_scratch.data(), summary.frame_count);
+	}
+
+	for(u32 counter = 0; counter < counter_count; ++counter)
+	{
+		for(u32 age = 0; age < summary.frame_count; ++age)
+			m_scratch[age] = static_cast<double>(sample(age).counters[counter]);
+		summary.counters[counter] = summarize_values(m_scratch.data(), summary.frame_count);
+	}
+
+	return summary;
+}
+
+bool FrameStats::write_csv( const std::string &path ) const
+{
+	std::FILE *file = std::fopen(path.c_str(), "w");
+	if( file == nullptr )
+	{
+		VV_ERROR("Cannot write the frame stats", path);
+		return false;
+	}
+
+	std::fprintf(file, "frame");
+	for(u32 metric = 0; metric < metric_count; ++metric)
+		std::fprintf(file, ",%s_ms", to_string(static_cast<FrameMetric>(metric)));
+	for(u32 counter = 0; counter < counter_count; ++counter)
+		std::fprintf(file, ",%s", to_string(static_cast<FrameCounter>(counter)));
+	std::fputc('\n', file);
+
+	for(u32 age = m_count; age-- > 0; )
+	{
+		const FrameSample &row = sample(age);
+		std::fprintf(file, "%" PRIu64, row.frame);
+		for(u32 metric = 0; metric < metric_count; ++metric)
+			std::fprintf(file, ",%.4f", row.times_ms[metric]);
+		for(u32 counter = 0; counter < counter_count; ++counter)
+			std::fprintf(file, ",%" PRIu64, row.counters[counter]);
+		std::fputc('\n', file);
+	}
+
+	bool written = std::ferror(file) == 0;
+	written = std::fclose(file) == 0 && written;
+
+	if( !written )
+	{
+		VV_ERROR("Cannot write the frame stats", path);
+		return false;
+	}
+
+	VV_INFO("Frame stats written to", path, ":", m_count, "frames");
+	return true;
+}
+
+std::size_t vv::format_frame_stats( const FrameStatsSummary &summary, char *out, std::size_t capacity )
+{
+	if( capacity == 0 )
+		return 0;
+
+	std::size_t length = 0;
+	auto append = [&]( const char *format, auto... args ) {
+		if( length + 1 >= capacity )
+			return;
+		int written = std::snprintf(out + length, capacity - length, format, args...);
+		if( written > 0 )
+			length = std::min(length + static_cast<std::size_t>(written), capacity - 1);
+	};
+
+	append("LAST %u FRAMES, MS\n", summary.frame_count);
+	append("%-8s%7s%7s%7s%7s%7s%7s\n", "", "MIN", "AVG", "P50", "P95", "P99", "MAX");
+
+	static const char *const metric_labels[metric_count] = { "FRAME", "UPDATE", "SUBMIT", "RENDER", "GPU" };
+	for(u32 metric = 0; metric < metric_count; ++metric)
+	{
+		const StatSummary &stat = summary.times[metric];
+		append("%-8s%7.2f%7.2f%7.2f%7.2f%7.2f%7.2f\n", metric_labels[metric],
+			stat.min, stat.avg, stat.p50, stat.p95, stat.p99, stat.max);
+	}
+
+	const StatSummary &draws = summary.counter(FrameCounter::draws);
+	const StatSummary &state_changes = summary.counter(FrameCounter::state_changes);
+	const StatSummary &uploaded = summary.counter(FrameCounter::bytes_uploaded);
+	append("DRAWS %.0f (MAX %.0f)  STATE CHANGES %.0f (MAX %.0f)\n", draws.avg, draws.max, state_changes.avg, state_changes.max);
+	append("UPLOADED %.1f KB (MAX %.1f KB)", uploaded.avg / 1024.0, uploaded.max / 1024.0);
+
+	return length;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vv
+{
+
+// Times measured every frame, in milliseconds
+enum class FrameMetric: u8
+{
+	frame,  // start of a frame to the start of the next one, pacing sleep included
+	update, // fixed ticks and layers' frame graph, update and command recording
+	submit, // handing the frame to the render thread, waiting for it included
+	render, // execute_frame on the render thread, swap included
+	gpu,    // GPU time of the frame, needs EngineParameters::gpu_profiling
+
+	count
+};
+
+enum class FrameCounter: u8
+{
+	draws,
+	state_changes, // GL state calls that reached the driver
+	bytes_uploaded,
+
+	count
+};
+
+const char *to_string( FrameMetric metric );
+const char *to_string( FrameCounter counter );
+
+struct FrameSample
+{
+	u64 frame = 0;
+	double times_ms[static_cast<u32>(FrameMetric::count)] = {};
+	u64 counters[static_cast<u32>(FrameCounter::count)] = {};
+
+	double &time( FrameMetric metric ) { return times_ms[static_cast<u32>(metric)]; }
+	u64 &counter( FrameCounter counter ) { return counters[static_cast<u32>(counter)]; }
+};
+
+struct StatSummary
+{
+	double min = 0.0;
+	double avg = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+struct FrameStatsSummary
+{
+	u32 frame_count = 0;
+	StatSummary times[static_cast<u32>(FrameMetric::count)];
+	StatSummary counters[static_cast<u32>(FrameCounter::count)];
+
+	const StatSummary &time( FrameMetric metric ) const { return times[static_cast<u32>(metric)]; }
+	const StatSummary &counter( FrameCounter counter ) const { return counters[static_cast<u32>(counter)]; }
+};
+
+// Min, average and percentiles (nearest rank) of `count` values, sorts them in place
+StatSummary summarize_values( double *values, u32 count );
+
+// Rolling history of the last frames. Everything is allocated by init(),
+// pushing a frame and summarizing it never allocate.
+class FrameStats
+{
+public:
+	// Keeps the last `history_frames` frames
+	void init( u32 history_frames );
+
+	void push( const FrameSample &sample );
+
+	// Min, average and percentiles (nearest rank) over the last `window_frames`
+	// frames, or over every kept frame when there are fewer
+	FrameStatsSummary summarize( u32 window_frames ) const;
+
+	u32 size() const { return m_count; }
+	u32 capacity() const { return static_cast<u32>(m_samples.size()); }
+
+	// Every kept frame, oldest first, one row per frame
+	bool write_csv( const std::string &path ) const;
+
+private:
+	const FrameSample &sample( u32 age ) const; // 0 is the last pushed frame
+
+	std::vector<FrameSample> m_samples;
+	u32 m_next = 0;
+	u32 m_count = 0;
+
+	mutable std::vector<double> m_scratch;
+};
+
+// The summary as a fixed width table for the stats overlay, always null
+// terminated. Returns the length written
+std::size_t format_frame_stats( const FrameStatsSummary &summary, char *out, std::size_t capacity );
+
+} // namespace vv
@@ -0,0 +1,303 @@
+#include "profiler.hpp"
+#include "logging/flight_recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+using namespace vv;
+
+#ifdef VV_PROFILER
+
+namespace
+{
+	struct ZoneRecord
+	{
+		const char *name;
+		u64 start;
+		u64 end;
+	};
+
+	struct ThreadZones
+	{
+		ZoneRecord zones[Profiler::zones_per_thread];
+
+		// capture generation in the high bits, zone count in the low ones: a new
+		// capture empties every buffer without touching them
+		std::atomic<u64> state { 0 };
+	};
+
+	// A thread of the captures. The zone buffer is only allocated by the first
+	// capture, and never freed, like the threads' flight recorder rings
+	struct Track
+	{
+		std::atomic<ThreadZones*> zones { nullptr };
+		std::atomic<const char*> name { nullptr };
+	};
+
+	Track g_tracks[Profiler::max_threads];
+	std::atomic<u32> g_track_count { 0 };
+
+	thread_local Track *t_track = nullptr;
+	thread_local bool t_unprofiled = false; // past max_threads
+
+	Track *g_gpu_track = nullptr;
+	bool g_gpu_unprofiled = false;
+
+	std::atomic<u32> g_generation { 0 };
+	std::atomic<bool> g_capturing { false };
+	u64 g_capture_start = 0;
+
+	// A new track in the captures, nullptr past max_threads
+	Track *register_track( const char *name )
+	{
+		u32 index = g_track_count.fetch_add(1, std::memory_order_relaxed);
+		if( index >= Profiler::max_threads )
+			return nullptr;
+
+		Track *track = &g_tracks[index];
+		track->name.store(name, std::memory_order_relaxed);
+		return track;
+	}
+
+	Track *thread_track()
+	{
+		if( t_track == nullptr && !t_unprofiled )
+		{
+			t_track = register_track(nullptr);
+			t_unprofiled = t_track == nullptr;
+		}
+		return t_track;
+	}
+
+	// begin_capture allocates the buffers of the tracks it knows, a thread
+	// registered during the capture allocates its own
+	ThreadZones *track_zones( Track &track )
+	{
+		ThreadZones *zones = track.zones.load(std::memory_order_acquire);
+		if( zones != nullptr )
+			return zones;
+
+		ThreadZones *created = new ThreadZones();
+		if( track.zones.compare_exchange_strong(zones, created, std::memory_order_acq_rel) )
+			return created;
+
+		delete created;
+		return zones;
+	}
+
+	void push_zone( ThreadZones &zones, const char *name, u64 start, u64 end )
+	{
+		u64 generation = g_generation.load(std::memory_order_relaxed);
+		u64 state = zones.state.load(std::memory_order_relaxed);
+		u32 count = (state >> 32) == generation ? static_cast<u32>(state) : 0;
+		if( count == Profiler::zones_per_thread )
+			return;
+
+		zones.zones[count] = ZoneRecord { name, start, end };
+		zones.state.store((generation << 32) | (count + 1), std::memory_order_release);
+	}
+
+	struct Calibration
+	{
+		u64 ticks = 0;
+		u64 nanoseconds = 0;
+		double nanoseconds_per_tick = 1.0;
+	};
+
+	// identity until Profiler::init
+	Calibration g_calibration;
+
+	Calibration calibrate()
+	{
+		Calibration calibration;
+		calibration.ticks = Profiler::ticks();
+		calibration.nanoseconds = Logger::now();
+
+	#if defined(VV_PROFILER_TSC)
+		// a couple of milliseconds is enough for a TSC in the GHz
+		u64 end_nanoseconds;
+		do {
+			end_nanoseconds = Logger::now();
+		} while( end_nanoseconds - calibration.nanoseconds < 2000000 );
+
+		u64 end_ticks = Profiler::ticks();
+		calibration.nanoseconds_per_tick = static_cast<double>(end_nanoseconds - calibration.nanoseconds) / static_cast<double>(end_ticks - calibration.ticks);
+	#endif
+
+		return calibration;
+	}
+
+	void write_json_string( std::FILE *file, const char *str )
+	{
+		std::fputc('"', file);
+		for(; *str != '\0'; ++str)
+		{
+			unsigned char c = static_cast<unsigned char>(*str);
+			if( c == '"' || c == '\\' )
+				std::fprintf(file, "\\%c", c);
+			else if( c < 0x20 )
+				std::fprintf(file, "\\u%04x", c);
+			else
+				std::fputc(c, file);
+		}
+		std::fputc('"', file);
+	}
+}
+
+void Profiler::init()
+{
+	g_calibration = calibrate();
+	FlightRecorder::set_zone_clock(g_calibration.ticks, g_calibration.nanoseconds, g_calibration.nanoseconds_per_tick);
+}
+
+u64 Profiler::to_nanoseconds( u64 ticks )
+{
+	const Calibration &base = g_calibration;
+	double elapsed = static_cast<double>(static_cast<i64>(ticks - base.ticks)) * base.nanoseconds_per_tick;
+	return base.nanoseconds + static_cast<i64>(elapsed);
+}
+
+u64 Profiler::from_nanoseconds( u64 nanoseconds )
+{
+	const Calibration &base = g_calibration;
+	double elapsed = static_cast<double>(static_cast<i64>(nanoseconds - base.nanoseconds)) / base.nanoseconds_per_tick;
+	return base.ticks + static_cast<i64>(elapsed);
+}
+
+void Profiler::set_thread_name( const char *name )
+{
+	// a track without its buffer, the next capture allocates it
+	if( Track *track = thread_track() )
+		track->name.store(name, std::memory_order_relaxed);
+}
+
+void Profiler::record( const char *name, u64 start, u64 end )
+{
+	if( FlightRecorder::active() )
+		FlightRecorder::record_zone(name, start, end);
+
+	if( !g_capturing.load(std::memory_order_relaxed) )
+		return;
+
+	if( Track *track = thread_track() )
+		push_zone(*track_zones(*track), name, start, end);
+}
+
+void Profiler::record_gpu( const char *name, u64 start_ns, u64 end_ns )
+{
+	if( !g_capturing.load(std::memory_order_relaxed) )
+		return;
+
+	if( g_gpu_track == nullptr && !g_gpu_unprofiled )
+	{
+		g_gpu_track = register_track("gpu");
+		g_gpu_unprofiled = g_gpu_track == nullptr;
+	}
+
+	if( g_gpu_track != nullptr )
+		push_zone(*track_zones(*g_gpu_track), name, from_nanoseconds(start_ns), from_nanoseconds(end_ns));
+}
+
+void Profiler::begin_capture()
+{
+	// the buffers of the threads named so far, not in their first captured zone
+	u32 track_count = std::min(g_track_count.load(std::memory_order_relaxed), max_threads);
+	for(u32 i = 0; i < track_count; ++i)
+		track_zones(g_tracks[i]);
+
+	g_generation.fetch_add(1, std::memory_order_relaxed);
+	g_capture_start = ticks();
+	g_capturing.store(true, std::memory_order_release);
+}
+
+bool Profiler::capturing()
+{
+	return g_capturing.load(std::memory_order_relaxed);
+}
+
+bool Profiler::end_capture( const std::string &path )
+{
+	g_capturing.store(false, std::memory_order_release);
+
+	std::FILE *file = std::fopen(path.c_str(), "w");
+	if( file == nullptr )
+	{
+		VV_ERROR("Cannot write the profile capture", path);
+		return false;
+	}
+
+	u64 generation = g_generation.load(std::memory_order_relaxed);
+	u64 capture_start = to_nanoseconds(g_capture_start);
+	u32 track_count = std::min(g_track_count.load(std::memory_order_relaxed), max_threads);
+	u64 zone_count = 0;
+	bool first = true;
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for(u32 i = 0; i < track_count; ++i)
+	{
+		const ThreadZones *zones = g_tracks[i].zones.load(std::memory_order_acquire);
+		if( zones == nullptr )
+			continue;
+
+		u64 state = zones->state.load(std::memory_order_acquire);
+		u32 count = (state >> 32) == generation ? static_cast<u32>(state) : 0;
+		if( count == 0 )
+			continue;
+
+		if( count == zones_per_thread )
+			VV_WARN("Profile capture: thread", i, "filled its buffer, later zones were dropped");
+
+		const char *name = g_tracks[i].name.load(std::memory_order_relaxed);
+		std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", i);
+		write_json_string(file, name ? name : "unnamed thread");
+		std::fprintf(file, "}}");
+		first = false;
+
+		for(u32 zone = 0; zone < count; ++zone)
+		{
+			const ZoneRecord &record = zones->zones[zone];
+			double start_us = static_cast<double>(static_cast<i64>(to_nanoseconds(record.start) - capture_start)) * 1e-3;
+			double duration_us = static_cast<double>(to_nanoseconds(record.end) - to_nanoseconds(record.start)) * 1e-3;
+
+			std::fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", i, start_us, duration_us);
+			write_json_string(file, record.name);
+			std::fputc('}', file);
+		}
+
+		zone_count += count;
+	}
+
+	std::fprintf(file, "\n]}\n");
+	bool written = std::ferror(file) == 0;
+	written = std::fclose(file) == 0 && written;
+
+	if( !written )
+	{
+		VV_ERROR("Cannot write the profile capture", path);
+		return false;
+	}
+
+	VV_INFO("Profile capture written to", path, ":", zone_count, "zones");
+	return true;
+}
+
+#else // VV_PROFILER
+
+void Profiler::init() {}
+u64 Profiler::to_nanoseconds( u64 ticks ) { return ticks; }
+u64 Profiler::from_nanoseconds( u64 nanoseconds ) { return nanoseconds; }
+void Profiler::set_thread_name( const char * ) {}
+void Profiler::record( const char *, u64, u64 ) {}
+void Profiler::record_gpu( const char *, u64, u64 ) {}
+void Profiler::begin_capture() {}
+bool Profiler::capturing() { return false; }
+
+bool Profiler::end_capture( const std::string &path )
+{
+	VV_WARN("Cannot write the profile capture", path, ": the profiler is not compiled in (VROUM_PROFILER)");
+	return false;
+}
+
+#endif // VV_PROFILER
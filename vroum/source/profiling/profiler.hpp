@@ -0,0 +1,95 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+#include <string>
+
+#if defined(VV_PROFILER) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+	#define VV_PROFILER_TSC
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+namespace vv
+{
+
+// CPU profiler, compiled in with the VROUM_PROFILER CMake option. Every
+// VV_PROFILE_SCOPE zone goes to the flight recorder and, while a capture is
+// running, to a buffer owned by the calling thread. A capture is exported as
+// a Chrome trace (chrome://tracing, ui.perfetto.dev). Timestamps are raw TSC
+// ticks on x86, steady clock nanoseconds elsewhere, converted when leaving
+// the thread. Without the option the zones compile to nothing.
+namespace Profiler
+{
+#ifdef VV_PROFILER
+	constexpr bool enabled = true;
+#else
+	constexpr bool enabled = false;
+#endif
+
+	constexpr u32 max_threads = 64;
+	constexpr u32 zones_per_thread = 32 * 1024; // per capture, later zones are dropped
+
+	inline u64 ticks()
+	{
+	#if defined(VV_PROFILER_TSC)
+		return __rdtsc();
+	#else
+		return Logger::now();
+	#endif
+	}
+
+	// Measures the tick rate, spinning a couple of milliseconds on x86. Called
+	// by the engine at startup, before the first zone to convert
+	void init();
+
+	// Ticks to steady clock nanoseconds, comparable with Logger::now(), and back
+	u64 to_nanoseconds( u64 ticks );
+	u64 from_nanoseconds( u64 nanoseconds );
+
+	// Names the calling thread in the captures, `name` must outlive the program.
+	// Its zone buffer is allocated by the next begin_capture
+	void set_thread_name( const char *name );
+
+	// Called by ProfileZone, `name` must outlive the program
+	void record( const char *name, u64 start, u64 end );
+
+	// A zone of the "gpu" track, in steady clock nanoseconds. GpuProfiler
+	// calls it from the render thread, the only writer of that track
+	void record_gpu( const char *name, u64 start_ns, u64 end_ns );
+
+	// Zones recorded from now on are kept until end_capture
+	void begin_capture();
+	bool capturing();
+
+	// Stops the capture and writes it as Chrome trace JSON to `path`
+	bool end_capture( const std::string &path );
+}
+
+// Times the enclosing scope
+class ProfileZone
+{
+public:
+	explicit ProfileZone( const char *name ): m_name(name), m_start(Profiler::ticks()) {}
+	~ProfileZone() { Profiler::record(m_name, m_start, Profiler::ticks()); }
+
+	ProfileZone( const ProfileZone & ) = delete;
+	ProfileZone &operator=( const ProfileZone & ) = delete;
+
+private:
+	const char *m_name;
+	u64 m_start;
+};
+
+} // namespace vv
+
+#ifdef VV_PROFILER
+	#define VV_PROFILE_CONCAT_IMPL(a, b) a##b
+	#define VV_PROFILE_CONCAT(a, b) VV_PROFILE_CONCAT_IMPL(a, b)
+	#define VV_PROFILE_SCOPE(name) vv::ProfileZone VV_PROFILE_CONCAT(vv_profile_zone_, __LINE__)( name )
+#else
+	#define VV_PROFILE_SCOPE(name)
+#endif
@@ -0,0 +1,136 @@
+#include "frame_pacer.hpp"
+#include "tick_scheduler.hpp"
+#include "wait_strategy.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+	#include <sys/timerfd.h>
+	#include <unistd.h>
+#endif
+
+using namespace vv;
+
+const char *vv::to_string( PacingMethod method )
+{
+	switch( method )
+	{
+	case PacingMethod::sleep: return "sleep";
+	case PacingMethod::sleep_spin: return "sleep spin";
+	case PacingMethod::timerfd: return "timerfd";
+	default: return "unknown";
+	}
+}
+
+FramePacer::~FramePacer()
+{
+	shutdown();
+}
+
+void FramePacer::init( const FramePacerSettings &settings )
+{
+	m_settings = settings;
+	set_target_fps(settings.target_fps);
+
+	m_errors_us.assign(settings.measure ? std::max(settings.measured_frames, 1u) : 0, 0.0);
+	m_error_count = 0;
+	m_next_error = 0;
+	m_late_frames = 0;
+
+	if( m_settings.method == PacingMethod::timerfd )
+	{
+#if defined(__linux__)
+		m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+#endif
+		if( m_timer_fd < 0 )
+		{
+			VV_WARN("Frame pacer: no timerfd, pacing with sleep spin");
+			m_settings.method = PacingMethod::sleep_spin;
+		}
+	}
+
+	use_precise_timers();
+}
+
+void FramePacer::shutdown()
+{
+#if defined(__linux__)
+	if( m_timer_fd >= 0 )
+		close(m_timer_fd);
+#endif
+	m_timer_fd = -1;
+
+	if( m_error_count > 0 )
+	{
+		StatSummary error = pacing_error();
+		VV_INFO("Frame pacing,", to_string(m_settings.method), "method: woke up late by p50", error.p50, "p95", error.p95,
+			"p99", error.p99, "max", error.max, "us over", m_error_count, "frames,", m_late_frames, "frames were already late");
+		m_error_count = 0;
+	}
+}
+
+void FramePacer::set_target_fps( u32 target_fps )
+{
+	m_period_ns = target_fps > 0 ? 1000000000ull / target_fps : 0;
+}
+
+void FramePacer::wait( u64 frame_start )
+{
+	if( m_period_ns == 0 )
+		return;
+
+	u64 deadline = frame_start + m_period_ns;
+	if( Logger::now() >= deadline )
+	{
+		++m_late_frames;
+		return;
+	}
+
+	u64 spin_ns = m_settings.method == PacingMethod::sleep ? 0 : static_cast<u64>(m_settings.spin_us) * 1000;
+	if( deadline > spin_ns )
+		sleep_until(deadline - spin_ns);
+
+	u64 now = Logger::now();
+	while( now < deadline )
+	{
+		cpu_relax();
+		now = Logger::now();
+	}
+
+	if( !m_errors_us.empty() )
+	{
+		m_errors_us[m_next_error] = static_cast<double>(now - deadline) * 1e-3;
+		m_next_error = (m_next_error + 1) % m_errors_us.size();
+		m_error_count = std::min<u32>(m_error_count + 1, m_errors_us.size());
+	}
+}
+
+void FramePacer::sleep_until( u64 deadline )
+{
+	if( Logger::now() >= deadline )
+		return;
+
+#if defined(__linux__)
+	if( m_timer_fd >= 0 )
+	{
+		itimerspec timer = {};
+		timer.it_value.tv_sec = static_cast<time_t>(deadline / 1000000000ull);
+		timer.it_value.tv_nsec = static_cast<long>(deadline % 1000000000ull);
+
+		// read() blocks until the timer expires, steady_clock is CLOCK_MONOTONIC
+		u64 expirations = 0;
+		if( timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr) == 0
+			&& read(m_timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations) )
+			return;
+	}
+#endif
+
+	sleep_until_ns(deadline);
+}
+
+StatSummary FramePacer::pacing_error() const
+{
+	// summarizing sorts the values, the ring keeps its order
+	std::vector<double> sorted(m_errors_us.begin(), m_errors_us.begin() + m_error_count);
+	return summarize_values(sorted.data(), m_error_count);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "profiling/frame_stats.hpp"
+
+#include <vector>
+
+namespace vv
+{
+
+// How FramePacer waits for the end of a frame
+enum class PacingMethod: u8
+{
+	sleep,      // one sleep to the deadline, wakes up late by the timer resolution
+	sleep_spin, // sleeps until spin_us before the deadline, then spins
+	timerfd,    // sleep_spin on a timerfd armed with TFD_TIMER_ABSTIME, Linux only
+};
+
+const char *to_string( PacingMethod method );
+
+struct FramePacerSettings
+{
+	u32 target_fps = 0; // 0 for no limit
+	PacingMethod method = PacingMethod::sleep_spin;
+	u32 spin_us = 1000;
+
+	// keeps how late every wait woke up, reported by shutdown()
+	bool measure = false;
+	u32 measured_frames = 4096; // the last ones are kept
+};
+
+// Caps the frame rate. A frame lasts at least 1 / target_fps from its start,
+// the last spin_us are spent spinning so the wake up does not depend on when
+// the scheduler gets back to the thread.
+class FramePacer
+{
+public:
+	FramePacer() = default;
+	~FramePacer();
+
+	FramePacer( const FramePacer & ) = delete;
+	FramePacer &operator=( const FramePacer & ) = delete;
+
+	void init( const FramePacerSettings &settings );
+	void shutdown();
+
+	// From the next wait() on, 0 for no limit
+	void set_target_fps( u32 target_fps );
+
+	// Waits until the frame started at `frame_start` (Logger::now() time) lasted
+	// its period. Returns right away without a target or when the frame is late
+	void wait( u64 frame_start );
+
+	// Wake up error of the measured waits, in microseconds. Waits that found
+	// the frame already late are not counted
+	StatSummary pacing_error() const;
+
+private:
+	void sleep_until( u64 deadline );
+
+	FramePacerSettings m_settings;
+	u64 m_period_ns = 0;
+	int m_timer_fd = -1;
+
+	std::vector<double> m_errors_us; // ring, allocated by init()
+	u32 m_error_count = 0;
+	u32 m_next_error = 0;
+	u64 m_late_frames = 0;
+};
+
+} // namespace vv
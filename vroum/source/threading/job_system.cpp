@@ -0,0 +1,274 @@
+#include "job_system.hpp"
+#include "thread_name.hpp"
+
+#include <cstdlib>
+
+using namespace vv;
+
+namespace
+{
+	thread_local JobSystem *t_job_system = nullptr;
+	thread_local u32 t_worker_index = JobSystem::not_a_worker;
+}
+
+bool JobDeque::push( Job *job )
+{
+	i64 bottom = m_bottom.load(std::memory_order_relaxed);
+	i64 top = m_top.load(std::memory_order_acquire);
+
+	if( bottom - top >= capacity )
+		return false;
+
+	m_buffer[bottom & (capacity - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job *JobDeque::pop()
+{
+	i64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	i64 top = m_top.load(std::memory_order_relaxed);
+
+	if( top > bottom )
+	{
+		// empty
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job *job = m_buffer[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+	if( top == bottom )
+	{
+		// last job: race against the thieves for it
+		if( !m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) )
+			job = nullptr;
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+Job *JobDeque::steal()
+{
+	i64 top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	i64 bottom = m_bottom.load(std::memory_order_acquire);
+
+	if( top >= bottom )
+		return nullptr;
+
+	Job *job = m_buffer[top & (capacity - 1)].load(std::memory_order_relaxed);
+	if( !m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) )
+		return nullptr;
+
+	return job;
+}
+
+u32 JobSystem::thread_index()
+{
+	return t_worker_index;
+}
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+	shutdown();
+}
+
+bool JobSystem::init( u32 worker_count, const WaitStrategy &strategy )
+{
+	assert( m_data.empty() ); // double initialization
+
+	if( worker_count == 0 )
+	{
+		u32 cores = std::thread::hardware_concurrency();
+		worker_count = cores > 1 ? cores - 1 : 1;
+	}
+
+	m_wait_strategy = strategy;
+	m_running = true;
+
+	for(u32 i = 0; i < worker_count + 1; ++i)
+	{
+		m_data.push_back( std::make_unique<WorkerData>() );
+		m_data.back()->steal_seed = 0x9E3779B9u * (i + 1);
+	}
+
+	// the calling thread is worker 0, it submits and helps while waiting
+	t_job_system = this;
+	t_worker_index = 0;
+
+	for(u32 i = 1; i < worker_count + 1; ++i)
+		m_workers.emplace_back(&JobSystem::worker_loop, this, i);
+
+	VV_INFO("Job system started with", worker_count, "workers");
+	return true;
+}
+
+void JobSystem::shutdown()
+{
+	if( !m_running )
+		return;
+
+	m_running = false;
+	m_work_epoch.fetch_add(1, std::memory_order_release);
+	atomic_unpark_all(m_work_epoch);
+
+	for(auto &worker: m_workers)
+		worker.join();
+
+	m_workers.clear();
+	m_data.clear();
+
+	if( t_job_system == this )
+	{
+		t_job_system = nullptr;
+		t_worker_index = not_a_worker;
+	}
+}
+
+void JobSystem::wait( JobCounter &counter )
+{
+	// a foreign thread has no deque to steal into, it never executes jobs
+	bool foreign = t_job_system != this;
+
+	u32 idle = 0;
+	while( !counter.done() )
+	{
+		Job *job = foreign ? nullptr : find_job(t_worker_index);
+		if( job != nullptr )
+		{
+			execute(job);
+			idle = 0;
+		}
+		else if( ++idle < m_wait_strategy.spin_count )
+		{
+			cpu_relax();
+		}
+		else
+		{
+			// the remaining jobs are running on other threads
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool JobSystem::try_run_job()
+{
+	if( t_job_system != this )
+		return false;
+
+	Job *job = find_job(t_worker_index);
+	if( job == nullptr )
+		return false;
+
+	execute(job);
+	return true;
+}
+
+Job *JobSystem::allocate_job()
+{
+	if( t_job_system != this )
+	{
+		// jobs go to the deque of the calling thread, other threads have none
+		VV_FATAL("Job submitted from a thread outside the job system");
+		std::abort();
+	}
+
+	WorkerData &data = *m_data[t_worker_index];
+
+	// slots are reused in order, skip the ones whose job has not run yet
+	for(u32 i = 0; i < job_pool_size; ++i)
+	{
+		Job *job = &data.jobs[data.next_job];
+		data.next_job = (data.next_job + 1) % job_pool_size;
+
+		if( !job->in_use.load(std::memory_order_acquire) )
+		{
+			job->in_use.store(true, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::submit( Job *job )
+{
+	if( !m_data[t_worker_index]->deque.push(job) )
+	{
+		// deque full, don't queue more work than we can hold
+		execute(job);
+		return;
+	}
+
+	m_work_epoch.fetch_add(1, std::memory_order_release);
+	notify_if_waiting(m_work_epoch, m_sleeping);
+}
+
+Job *JobSystem::find_job( u32 self )
+{
+	if( Job *job = m_data[self]->deque.pop() )
+		return job;
+
+	// start from a random victim so thieves spread over the workers
+	u32 &seed = m_data[self]->steal_seed;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	u32 count = static_cast<u32>(m_data.size());
+	for(u32 i = 0; i < count; ++i)
+	{
+		u32 victim = (seed + i) % count;
+		if( victim == self )
+			continue;
+
+		if( Job *job = m_data[victim]->deque.steal() )
+			return job;
+	}
+
+	return nullptr;
+}
+
+void JobSystem::execute( Job *job )
+{
+	job->invoke(*job);
+
+	JobCounter *counter = job->counter;
+	job->invoke = nullptr;
+	job->counter = nullptr;
+
+	// the counter may be destroyed as soon as it reaches 0, don't touch it afterwards
+	counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+	job->in_use.store(false, std::memory_order_release);
+}
+
+void JobSystem::worker_loop( u32 index )
+{
+	set_thread_name("job worker");
+
+	t_job_system = this;
+	t_worker_index = index;
+
+	while( m_running.load(std::memory_order_acquire) )
+	{
+		// read the epoch before looking for work: a job pushed after that
+		// bumps it, so we can't go to sleep on a job we missed
+		u32 epoch = m_work_epoch.load(std::memory_order_acquire);
+
+		if( Job *job = find_job(index) )
+		{
+			execute(job);
+			continue;
+		}
+
+		wait_while_equal(m_wait_strategy, m_work_epoch, epoch, m_sleeping);
+	}
+}
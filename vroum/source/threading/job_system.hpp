@@ -0,0 +1,185 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "wait_strategy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vv
+{
+
+// Number of jobs still running for a group, waiting on it helps executing
+// other jobs instead of blocking the thread
+struct JobCounter
+{
+	std::atomic<u32> pending { 0 };
+
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// A job owns a copy of its functor, small enough to live in the job itself
+struct alignas(cache_line_size) Job
+{
+	static constexpr std::size_t storage_size = 40;
+
+	void (*invoke)( Job &job ) = nullptr;
+	JobCounter *counter = nullptr;
+	std::atomic<bool> in_use { false };
+	alignas(std::max_align_t) unsigned char storage[storage_size];
+};
+
+// Chase-Lev work stealing deque of fixed capacity (Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models"). The owner pushes and pops
+// at the bottom, the other workers steal from the top.
+class JobDeque
+{
+public:
+	static constexpr i64 capacity = 4096;
+
+	// Owner only, returns false when full
+	bool push( Job *job );
+
+	// Owner only
+	Job *pop();
+
+	// Any thread
+	Job *steal();
+
+private:
+	alignas(cache_line_size) std::atomic<i64> m_top { 0 };
+	alignas(cache_line_size) std::atomic<i64> m_bottom { 0 };
+	alignas(cache_line_size) std::atomic<Job*> m_buffer[capacity];
+};
+
+// Fixed pool of worker threads. Jobs are pushed on the deque of the calling
+// thread and idle workers steal them. Only the thread that called init() and
+// the workers themselves can submit jobs.
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	// `worker_count` threads besides the calling one, 0 for one per remaining core
+	bool init( u32 worker_count = 0, const WaitStrategy &strategy = {} );
+	void shutdown();
+
+	// Runs `fn()` on any thread, `counter` reaches 0 once every job run on it is done
+	template <typename Fn>
+	void run( JobCounter &counter, Fn &&fn );
+
+	// Executes pending jobs until `counter` reaches 0. A thread outside the job
+	// system can't run jobs, it only waits for the workers to finish them
+	void wait( JobCounter &counter );
+
+	// Executes one pending job on the calling thread, false when it found none
+	bool try_run_job();
+
+	// Calls `fn(begin, end)` on sub ranges of [begin, end) of at most `grain`
+	// elements, in parallel, and returns once all of them are done.
+	// `grain` 0 splits the range in a few chunks per thread.
+	template <typename Fn>
+	void parallel_for( u32 begin, u32 end, u32 grain, Fn &&fn );
+
+	// How wait() spins before yielding, for threads waiting on something else
+	const WaitStrategy &wait_strategy() const { return m_wait_strategy; }
+
+	// Workers plus the submitting thread
+	u32 thread_count() const { return static_cast<u32>(m_workers.size()) + 1; }
+
+	// Index of the calling thread in [0, thread_count()), 0 being the thread that
+	// called init(). not_a_worker on threads that don't belong to a job system.
+	static constexpr u32 not_a_worker = ~0u;
+	static u32 thread_index();
+
+private:
+	static constexpr u32 job_pool_size = 4096;
+
+	struct WorkerData
+	{
+		JobDeque deque;
+		Job jobs[job_pool_size];
+		u32 next_job = 0;
+		u32 steal_seed = 0;
+	};
+
+	// nullptr when all the jobs of the calling thread are pending
+	Job *allocate_job();
+	void submit( Job *job );
+	Job *find_job( u32 self );
+	void execute( Job *job );
+	void worker_loop( u32 index );
+
+	std::vector<std::unique_ptr<WorkerData>> m_data; // 0 belongs to the submitting thread
+	std::vector<std::thread> m_workers;
+	WaitStrategy m_wait_strategy;
+
+	alignas(cache_line_size) std::atomic<u32> m_work_epoch { 0 };
+	alignas(cache_line_size) std::atomic<u32> m_sleeping { 0 };
+	std::atomic<bool> m_running { false };
+};
+
+template <typename Fn>
+void JobSystem::run( JobCounter &counter, Fn &&fn )
+{
+	using Functor = std::decay_t<Fn>;
+	static_assert(sizeof(Functor) <= Job::storage_size, "job functor too big, capture by reference or pointer");
+	static_assert(alignof(Functor) <= alignof(std::max_align_t), "job functor over aligned");
+
+	Job *job = allocate_job();
+	if( job == nullptr )
+	{
+		// every job of this thread is still pending, run it right away
+		fn();
+		return;
+	}
+
+	new (job->storage) Functor(std::forward<Fn>(fn));
+	job->invoke = []( Job &self ) {
+		Functor &functor = *std::launder(reinterpret_cast<Functor*>(self.storage));
+		functor();
+		functor.~Functor();
+	};
+	job->counter = &counter;
+
+	counter.pending.fetch_add(1, std::memory_order_relaxed);
+	submit(job);
+}
+
+template <typename Fn>
+void JobSystem::parallel_for( u32 begin, u32 end, u32 grain, Fn &&fn )
+{
+	if( begin >= end )
+		return;
+
+	u32 count = end - begin;
+	if( grain == 0 )
+		grain = std::max(1u, count / (thread_count() * 4));
+
+	// nothing to split
+	if( count <= grain || m_workers.empty() )
+	{
+		fn(begin, end);
+		return;
+	}
+
+	JobCounter counter;
+	auto *function = &fn;
+	for(u32 first = begin; first < end; first += grain)
+	{
+		u32 last = first + std::min(grain, end - first);
+		run(counter, [function, first, last]() { (*function)(first, last); });
+	}
+
+	wait(counter);
+}
+
+} // namespace vv
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "wait_strategy.hpp"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace vv
+{
+
+// Bounded single-producer / single-consumer ring buffer.
+// Exactly one thread may push and exactly one thread may consume,
+// neither side ever takes a lock or allocates after construction.
+template <typename T, u32 Capacity>
+class SpscRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+	SpscRing():
+		m_slots(std::make_unique<T[]>(Capacity))
+	{
+	}
+
+	SpscRing(const SpscRing &) = delete;
+	SpscRing &operator=(const SpscRing &) = delete;
+
+	void set_wait_strategy( const WaitStrategy &strategy ) { m_strategy = strategy; }
+
+	static constexpr u32 capacity() { return Capacity; }
+
+	// Producer side
+
+	bool try_push( T &&value )
+	{
+		u32 tail = m_tail.load(std::memory_order_relaxed);
+
+		if( tail - m_producer.cached_head == Capacity )
+		{
+			m_producer.cached_head = m_head.load(std::memory_order_acquire);
+			if( tail - m_producer.cached_head == Capacity )
+				return false;
+		}
+
+		m_slots[tail & mask] = std::move(value);
+		m_tail.store(tail + 1, std::memory_order_release);
+		notify_if_waiting(m_tail, m_consumer_waiting);
+
+		return true;
+	}
+
+	// Waits with the ring's wait strategy while the ring is full
+	void push( T &&value )
+	{
+		while( !try_push(std::move(value)) )
+		{
+			u32 head = m_producer.cached_head;
+			wait_while_equal(m_strategy, m_head, head, m_producer_waiting);
+		}
+	}
+
+	void push( const T &value )
+	{
+		T copy = value;
+		push(std::move(copy));
+	}
+
+	// Consumer side
+
+	bool empty() const
+	{
+		return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+	}
+
+	// Waits with the ring's wait strategy until there is something to consume
+	void wait_for_data()
+	{
+		u32 head = m_head.load(std::memory_order_relaxed);
+		if( m_consumer.cached_tail != head )
+			return;
+
+		wait_while_equal(m_strategy, m_tail, head, m_consumer_waiting);
+	}
+
+	// Calls `fn(T&)` on every available element, in order, and hands all
+	// their slots back to the producer at once. Returns the element count
+	template <typename Fn>
+	u32 consume_all( Fn &&fn )
+	{
+		u32 head = m_head.load(std::memory_order_relaxed);
+		u32 tail = m_tail.load(std::memory_order_acquire);
+		m_consumer.cached_tail = tail;
+
+		if( head == tail )
+			return 0;
+
+		for(u32 i = head; i != tail; ++i)
+			fn(m_slots[i & mask]);
+
+		m_head.store(tail, std::memory_order_release);
+		notify_if_waiting(m_head, m_producer_waiting);
+
+		return tail - head;
+	}
+
+private:
+	static constexpr u32 mask = Capacity - 1;
+
+	// each thread has its own line, and each shared index has its own line
+	struct alignas(cache_line_size) ProducerState { u32 cached_head = 0; };
+	struct alignas(cache_line_size) ConsumerState { u32 cached_tail = 0; };
+
+	alignas(cache_line_size) std::atomic<u32> m_head { 0 };
+	alignas(cache_line_size) std::atomic<u32> m_tail { 0 };
+	alignas(cache_line_size) std::atomic<u32> m_consumer_waiting { 0 };
+	alignas(cache_line_size) std::atomic<u32> m_producer_waiting { 0 };
+	ProducerState m_producer;
+	ConsumerState m_consumer;
+
+	WaitStrategy m_strategy;
+	std::unique_ptr<T[]> m_slots;
+};
+
+} // namespace vv
@@ -0,0 +1,283 @@
+#include "task_graph.hpp"
+#include "memory/alloc_profiler.hpp"
+#include "profiling/profiler.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace vv;
+
+using dmilliseconds = std::chrono::duration<double, std::milli>;
+
+const char *vv::to_string( FrameStage stage )
+{
+	switch( stage )
+	{
+	case FrameStage::input: return "input";
+	case FrameStage::simulation: return "simulation";
+	case FrameStage::animation: return "animation";
+	case FrameStage::culling: return "culling";
+	case FrameStage::render_prep: return "render prep";
+	default: return "unknown";
+	}
+}
+
+void FrameTaskGraph::clear()
+{
+	for(u32 i = 0; i < m_task_count; ++i)
+		m_tasks[i]->function = nullptr;
+
+	m_task_count = 0;
+	m_resources.clear();
+	m_skip_writers = false;
+}
+
+void FrameTaskGraph::skip_writers_of( TaskResource resource )
+{
+	m_skip_writers = true;
+	m_skipped_resource = resource;
+}
+
+void FrameTaskGraph::add_task( const TaskDesc &desc, std::function<void()> function )
+{
+	if( m_skip_writers && std::find(desc.writes.begin(), desc.writes.end(), m_skipped_resource) != desc.writes.end() )
+		return;
+
+	if( m_task_count == m_tasks.size() )
+		m_tasks.push_back( std::make_unique<Task>() );
+
+	Task &task = *m_tasks[m_task_count++];
+	task.name = desc.name;
+	task.stage = desc.stage;
+	task.game_thread = desc.game_thread;
+	task.first_resource = static_cast<u32>(m_resources.size());
+	task.read_count = static_cast<u32>(desc.reads.size());
+	task.write_count = static_cast<u32>(desc.writes.size());
+	task.function = std::move(function);
+
+	m_resources.insert(m_resources.end(), desc.reads.begin(), desc.reads.end());
+	m_resources.insert(m_resources.end(), desc.writes.begin(), desc.writes.end());
+}
+
+bool FrameTaskGraph::conflict( const Task &before, const Task &after ) const
+{
+	const TaskResource *before_reads = m_resources.data() + before.first_resource;
+	const TaskResource *before_writes = before_reads + before.read_count;
+	const TaskResource *after_reads = m_resources.data() + after.first_resource;
+	const TaskResource *after_writes = after_reads + after.read_count;
+
+	auto contains = []( const TaskResource *first, u32 count, TaskResource resource ) {
+		return std::find(first, first + count, resource) != first + count;
+	};
+
+	// write then read, write then write
+	for(u32 i = 0; i < before.write_count; ++i)
+	{
+		if( contains(after_reads, after.read_count, before_writes[i]) ||
+			contains(after_writes, after.write_count, before_writes[i]) )
+			return true;
+	}
+
+	// read then write
+	for(u32 i = 0; i < before.read_count; ++i)
+	{
+		if( contains(after_writes, after.write_count, before_reads[i]) )
+			return true;
+	}
+
+	return false;
+}
+
+void FrameTaskGraph::build()
+{
+	// stages first, declaration order inside a stage
+	m_order.resize(m_task_count);
+	for(u32 i = 0; i < m_task_count; ++i)
+		m_order[i] = i;
+
+	std::sort(m_order.begin(), m_order.end(), [this]( u32 a, u32 b ) {
+		if( m_tasks[a]->stage != m_tasks[b]->stage )
+			return m_tasks[a]->stage < m_tasks[b]->stage;
+		return a < b;
+	});
+
+	m_edges.clear();
+	for(u32 a = 0; a < m_task_count; ++a)
+	{
+		for(u32 b = a + 1; b < m_task_count; ++b)
+		{
+			if( conflict(*m_tasks[m_order[a]], *m_tasks[m_order[b]]) )
+				m_edges.push_back({ m_order[a], m_order[b] });
+		}
+	}
+
+	std::sort(m_edges.begin(), m_edges.end(), []( const Edge &a, const Edge &b ) {
+		return a.from < b.from;
+	});
+
+	for(u32 i = 0; i < m_task_count; ++i)
+	{
+		m_tasks[i]->successor_count = 0;
+		m_tasks[i]->predecessor_count = 0;
+	}
+
+	for(u32 i = 0; i < m_edges.size(); ++i)
+	{
+		Task &from = *m_tasks[m_edges[i].from];
+		if( from.successor_count++ == 0 )
+			from.first_successor = i;
+
+		m_tasks[m_edges[i].to]->predecessor_count++;
+	}
+}
+
+void FrameTaskGraph::execute( JobSystem &jobs )
+{
+	if( m_task_count == 0 )
+		return;
+
+	build();
+
+	for(u32 i = 0; i < m_task_count; ++i)
+		m_tasks[i]->remaining.store(m_tasks[i]->predecessor_count, std::memory_order_relaxed);
+
+	auto frame_start = std::chrono::steady_clock::now();
+
+	// never grows while tasks are released
+	m_game_thread_ready.clear();
+	m_game_thread_ready.reserve(m_task_count);
+	m_game_thread_ready_count.store(0, std::memory_order_relaxed);
+
+	JobCounter counter;
+	for(u32 i = 0; i < m_task_count; ++i)
+	{
+		if( m_tasks[i]->predecessor_count == 0 )
+			release_task(jobs, counter, i);
+	}
+
+	// help with the jobs, and run the game thread tasks as they get released.
+	// Backs off as JobSystem::wait does when there is nothing to do
+	u32 idle = 0;
+	while( !counter.done() )
+	{
+		u32 index = 0;
+		bool ready = false;
+		if( m_game_thread_ready_count.load(std::memory_order_relaxed) != 0 )
+		{
+			std::lock_guard<std::mutex> lock(m_game_thread_mtx);
+			if( !m_game_thread_ready.empty() )
+			{
+				index = m_game_thread_ready.back();
+				m_game_thread_ready.pop_back();
+				m_game_thread_ready_count.store(static_cast<u32>(m_game_thread_ready.size()), std::memory_order_relaxed);
+				ready = true;
+			}
+		}
+
+		if( ready )
+		{
+			run_task(jobs, counter, index);
+			counter.pending.fetch_sub(1, std::memory_order_acq_rel);
+			idle = 0;
+		}
+		else if( jobs.try_run_job() )
+		{
+			idle = 0;
+		}
+		else if( ++idle < jobs.wait_strategy().spin_count )
+		{
+			cpu_relax();
+		}
+		else
+		{
+			// the remaining tasks are running on other threads
+			std::this_thread::yield();
+		}
+	}
+
+	record_profile(frame_start);
+}
+
+void FrameTaskGraph::run_task( JobSystem &jobs, JobCounter &counter, u32 index )
+{
+	Task &task = *m_tasks[index];
+	VV_ALLOC_SCOPE("frame tasks");
+	VV_PROFILE_SCOPE(task.name);
+
+	task.start = std::chrono::steady_clock::now();
+	task.function();
+	task.end = std::chrono::steady_clock::now();
+
+	// successors are queued before this task completes, so `counter` can't reach 0 in between
+	for(u32 i = task.first_successor; i < task.first_successor + task.successor_count; ++i)
+	{
+		u32 next = m_edges[i].to;
+		if( m_tasks[next]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 )
+			release_task(jobs, counter, next);
+	}
+}
+
+void FrameTaskGraph::release_task( JobSystem &jobs, JobCounter &counter, u32 index )
+{
+	if( !m_tasks[index]->game_thread )
+	{
+		jobs.run(counter, [this, &jobs, &counter, index]() { run_task(jobs, counter, index); });
+		return;
+	}
+
+	// counted like a job until the game thread ran it
+	counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(m_game_thread_mtx);
+	m_game_thread_ready.push_back(index);
+	m_game_thread_ready_count.store(static_cast<u32>(m_game_thread_ready.size()), std::memory_order_relaxed);
+}
+
+void FrameTaskGraph::record_profile( std::chrono::steady_clock::time_point frame_start )
+{
+	m_profile.tasks.clear();
+	m_profile.critical_path.clear();
+	m_profile.total_ms = 0.0;
+	m_profile.critical_path_ms = 0.0;
+
+	u32 last = 0;
+	for(u32 i = 0; i < m_task_count; ++i)
+	{
+		const Task &task = *m_tasks[i];
+		m_profile.tasks.push_back({
+			task.name,
+			task.stage,
+			dmilliseconds(task.start - frame_start).count(),
+			dmilliseconds(task.end - frame_start).count()
+		});
+
+		if( task.end > m_tasks[last]->end )
+			last = i;
+	}
+
+	m_profile.total_ms = m_profile.tasks[last].end_ms;
+
+	// walk back from the last task to finish, through the predecessor that released each task
+	for(u32 current = last;;)
+	{
+		m_profile.critical_path.push_back(current);
+		m_profile.critical_path_ms += m_profile.tasks[current].end_ms - m_profile.tasks[current].start_ms;
+
+		bool found = false;
+		u32 releaser = 0;
+		for(const Edge &edge: m_edges)
+		{
+			if( edge.to == current && (!found || m_tasks[edge.from]->end > m_tasks[releaser]->end) )
+			{
+				releaser = edge.from;
+				found = true;
+			}
+		}
+
+		if( !found )
+			break;
+		current = releaser;
+	}
+
+	std::reverse(m_profile.critical_path.begin(), m_profile.critical_path.end());
+}
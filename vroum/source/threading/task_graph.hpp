@@ -0,0 +1,157 @@
+#pragma once
+
+#include "vv_headers.hpp"
+#include "job_system.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vv
+{
+
+// Coarse ordering of the frame. Tasks only wait on each other when they touch
+// the same resource, the stage decides which one goes first in that case.
+enum class FrameStage: u8
+{
+	input = 0,
+	simulation,
+	animation,
+	culling,
+	render_prep,
+	count
+};
+
+const char *to_string( FrameStage stage );
+
+// Anything tasks share: a component array, the world, the frame command list...
+using TaskResource = u32;
+
+constexpr TaskResource task_resource( const char *name )
+{
+	u32 hash = 2166136261u;
+	for(; *name != '\0'; ++name)
+		hash = (hash ^ static_cast<u8>(*name)) * 16777619u;
+	return hash;
+}
+
+namespace resources
+{
+	// written by every task that records into RenderingSystem::command_list()
+	constexpr TaskResource command_list = task_resource("command list");
+
+	// game state of the layers that do not declare anything finer
+	constexpr TaskResource world = task_resource("world");
+}
+
+struct TaskDesc
+{
+	const char *name = ""; // names profiler zones too: must outlive the program, string literals are fine
+	FrameStage stage = FrameStage::simulation;
+	std::initializer_list<TaskResource> reads;
+	std::initializer_list<TaskResource> writes;
+
+	// runs on the thread calling execute(), for code touching SDL or anything
+	// else bound to the game thread
+	bool game_thread = false;
+};
+
+// Timings of one executed graph, in milliseconds from the start of execute()
+struct FrameTaskProfile
+{
+	struct Task
+	{
+		const char *name;
+		FrameStage stage;
+		double start_ms;
+		double end_ms;
+	};
+
+	std::vector<Task> tasks;
+	std::vector<u32> critical_path; // indices in `tasks`, first to last
+	double total_ms = 0.0;
+	double critical_path_ms = 0.0; // time spent running the tasks of the critical path
+};
+
+// Task graph rebuilt every frame. Tasks declare what they read and write, a
+// task runs after every earlier one (by stage, then insertion order) it
+// conflicts with, everything else runs in parallel on the job system.
+class FrameTaskGraph
+{
+public:
+	void clear();
+
+	void add_task( const TaskDesc &desc, std::function<void()> function );
+
+	// Until the next clear(), tasks writing `resource` are dropped when added.
+	// An idle engine skips everything recording into the command list this way
+	void skip_writers_of( TaskResource resource );
+
+	// Runs every task and returns when all of them are done. Tasks run on any
+	// thread of the job system, the calling thread included, game_thread ones
+	// only on the calling thread.
+	void execute( JobSystem &jobs );
+
+	u32 task_count() const { return m_task_count; }
+
+	// What limited the last execute(): the chain of tasks that each released the next one
+	const FrameTaskProfile &last_profile() const { return m_profile; }
+
+private:
+	struct Task
+	{
+		const char *name = "";
+		FrameStage stage = FrameStage::simulation;
+		bool game_thread = false;
+		u32 first_resource = 0;
+		u32 read_count = 0;
+		u32 write_count = 0;
+		std::function<void()> function;
+
+		// filled by build()
+		u32 first_successor = 0;
+		u32 successor_count = 0;
+		u32 predecessor_count = 0;
+		std::atomic<u32> remaining { 0 };
+		std::chrono::steady_clock::time_point start, end;
+	};
+
+	struct Edge
+	{
+		u32 from;
+		u32 to;
+	};
+
+	void build();
+	bool conflict( const Task &before, const Task &after ) const;
+	void run_task( JobSystem &jobs, JobCounter &counter, u32 index );
+
+	// Queues a task whose predecessors are done, as a job or for the game thread
+	void release_task( JobSystem &jobs, JobCounter &counter, u32 index );
+	void record_profile( std::chrono::steady_clock::time_point frame_start );
+
+	// tasks hold an atomic so they can't move, they are kept from one frame to the next
+	std::vector<std::unique_ptr<Task>> m_tasks;
+	u32 m_task_count = 0;
+
+	std::vector<TaskResource> m_resources; // reads then writes of each task
+	std::vector<u32> m_order;              // tasks sorted by stage
+	std::vector<Edge> m_edges;             // sorted by `from`
+
+	// released game_thread tasks, executed by the thread in execute().
+	// The count is read without the lock first
+	std::vector<u32> m_game_thread_ready;
+	std::atomic<u32> m_game_thread_ready_count { 0 };
+	std::mutex m_game_thread_mtx;
+
+	bool m_skip_writers = false;
+	TaskResource m_skipped_resource = 0;
+
+	FrameTaskProfile m_profile;
+};
+
+} // namespace vv
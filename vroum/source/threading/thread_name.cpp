@@ -0,0 +1,11 @@
+#include "thread_name.hpp"
+#include "memory/alloc_profiler.hpp"
+#include "logging/flight_recorder.hpp"
+#include "profiling/profiler.hpp"
+
+void vv::set_thread_name( const char *name )
+{
+	AllocProfiler::set_thread_name(name);
+	FlightRecorder::set_thread_name(name);
+	Profiler::set_thread_name(name);
+}
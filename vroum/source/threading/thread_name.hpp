@@ -0,0 +1,10 @@
+#pragma once
+
+namespace vv
+{
+
+// Names the calling thread in the allocation reports, the flight recorder
+// dumps and the profiler captures. `name` must outlive the program.
+void set_thread_name( const char *name );
+
+} // namespace vv
@@ -0,0 +1,70 @@
+#include "tick_scheduler.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+	#include <cerrno>
+	#include <ctime>
+	#include <sys/prctl.h>
+#else
+	#include <chrono>
+	#include <thread>
+#endif
+
+using namespace vv;
+
+void TickScheduler::start( u32 tick_rate )
+{
+	m_period_ns = 1000000000ull / std::max(tick_rate, 1u);
+	m_next_tick = Logger::now() + m_period_ns;
+	m_late_ticks = 0;
+	m_dropped_ticks = 0;
+
+	use_precise_timers();
+}
+
+void TickScheduler::wait_next_tick()
+{
+	u64 now = Logger::now();
+
+	if( now < m_next_tick )
+	{
+		sleep_until_ns(m_next_tick);
+	}
+	else
+	{
+		++m_late_ticks;
+
+		u64 late = now - m_next_tick;
+		if( late > m_period_ns * max_late_ticks )
+		{
+			m_dropped_ticks += late / m_period_ns;
+			m_next_tick = now;
+		}
+	}
+
+	m_next_tick += m_period_ns;
+}
+
+void vv::sleep_until_ns( u64 deadline )
+{
+#if defined(__linux__)
+	// steady_clock is CLOCK_MONOTONIC, an absolute sleep does not drift with the call overhead
+	timespec time;
+	time.tv_sec = static_cast<time_t>(deadline / 1000000000ull);
+	time.tv_nsec = static_cast<long>(deadline % 1000000000ull);
+
+	while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) == EINTR )
+		;
+#else
+	std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#endif
+}
+
+void vv::use_precise_timers()
+{
+#if defined(__linux__)
+	// the default 50us of timer slack is most of the wake up error
+	prctl(PR_SET_TIMERSLACK, 1ul, 0ul, 0ul, 0ul);
+#endif
+}
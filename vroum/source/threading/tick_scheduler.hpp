@@ -0,0 +1,43 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+namespace vv
+{
+
+// Wakes the calling thread at a fixed rate. Deadlines are absolute, so a
+// tick running late does not push back the ones after it: the next ticks
+// start right away until the schedule is caught up.
+class TickScheduler
+{
+public:
+	// past this many periods late the missed ticks are dropped, not caught up
+	static constexpr u32 max_late_ticks = 4;
+
+	// The first tick is due one period from now
+	void start( u32 tick_rate );
+
+	// Sleeps until the next tick is due
+	void wait_next_tick();
+
+	u64 period_ns() const { return m_period_ns; }
+	double period_seconds() const { return static_cast<double>(m_period_ns) * 1e-9; }
+
+	// ticks started after their deadline, and the ones dropped
+	u64 late_ticks() const { return m_late_ticks; }
+	u64 dropped_ticks() const { return m_dropped_ticks; }
+
+private:
+	u64 m_period_ns = 0;
+	u64 m_next_tick = 0; // Logger::now() time
+	u64 m_late_ticks = 0;
+	u64 m_dropped_ticks = 0;
+};
+
+// Sleeps until Logger::now() reaches `deadline`
+void sleep_until_ns( u64 deadline );
+
+// Lowers the timer slack of the calling thread so its sleeps wake up on time
+void use_precise_timers();
+
+} // namespace vv
@@ -0,0 +1,78 @@
+#include "wait_strategy.hpp"
+
+#include <thread>
+#include <chrono>
+
+#if defined(__linux__)
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#elif defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+void vv::atomic_park( std::atomic<u32> &word, u32 expected )
+{
+	static_assert(sizeof(std::atomic<u32>) == sizeof(u32), "futex needs a plain 32 bits word");
+
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+	WaitOnAddress(&word, &expected, sizeof(u32), INFINITE);
+#else
+	// no address-based wait on this platform, sleep a bit and let the caller re-check
+	if( word.load(std::memory_order_acquire) == expected )
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+}
+
+void vv::atomic_unpark_all( std::atomic<u32> &word )
+{
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+	WakeByAddressAll(&word);
+#else
+	(void)word;
+#endif
+}
+
+void vv::wait_while_equal( const WaitStrategy &strategy, std::atomic<u32> &word, u32 expected, std::atomic<u32> &waiters )
+{
+	// spin: cheapest when the other side is about to publish
+	for(u32 i = 0; i < strategy.spin_count; ++i)
+	{
+		if( word.load(std::memory_order_acquire) != expected )
+			return;
+		cpu_relax();
+	}
+
+	// yield: let other threads run without leaving the scheduler queue
+	for(u32 i = 0; i < strategy.yield_count; ++i)
+	{
+		if( word.load(std::memory_order_acquire) != expected )
+			return;
+		std::this_thread::yield();
+	}
+
+	if( !strategy.park )
+	{
+		while( word.load(std::memory_order_acquire) == expected )
+			std::this_thread::yield();
+		return;
+	}
+
+	// park: register before the last check, the publisher checks the
+	// waiters after its store so one of us is guaranteed to see the other
+	while( word.load(std::memory_order_acquire) == expected )
+	{
+		waiters.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if( word.load(std::memory_order_relaxed) == expected )
+			atomic_park(word, expected);
+
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "vv_headers.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#include <immintrin.h>
+#endif
+
+namespace vv
+{
+
+// Size used to pad data shared between threads so that two hot
+// atomics never end up on the same cache line
+constexpr std::size_t cache_line_size = 64;
+
+// How a thread waits for a shared value to change: it busy-spins first,
+// then gives away its time slice, and finally parks in the kernel until
+// the other side wakes it up
+struct WaitStrategy
+{
+	u32 spin_count = 2048;
+	u32 yield_count = 64;
+	bool park = true;
+};
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// Blocks the calling thread while `word` holds `expected`.
+// Can return spuriously, callers must re-check their condition
+void atomic_park( std::atomic<u32> &word, u32 expected );
+
+// Wakes up every thread parked on `word`
+void atomic_unpark_all( std::atomic<u32> &word );
+
+// Waits with `strategy` until `word` differs from `expected`. `waiters` counts
+// the threads parked on `word` so the other side knows it has to wake them up
+void wait_while_equal( const WaitStrategy &strategy, std::atomic<u32> &word, u32 expected, std::atomic<u32> &waiters );
+
+// Counterpart of wait_while_equal, to call after modifying `word`
+inline void notify_if_waiting( std::atomic<u32> &word, std::atomic<u32> &waiters )
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if( waiters.load(std::memory_order_relaxed) != 0 )
+		atomic_unpark_all(word);
+}
+
+} // namespace vv
@@ -4,4 +4,6 @@
 
 #include "engine.hpp"
 #include "layer.hpp"
-#include "graphics/rendering_system.hpp"
\ No newline at end of file
+#include "graphics/rendering_system.hpp"
+#include "profiling/profiler.hpp"
+#include "threading/thread_name.hpp"
\ No newline at end of file
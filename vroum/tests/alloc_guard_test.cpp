@@ -0,0 +1,161 @@
+// Runs the engine headless for a few hundred frames with the steady state
+// allocation guard on. The engine aborts on the first frame past the warm-up
+// that calls operator new, so a zero exit code means no frame allocated.
+//
+//   vroum_alloc_guard_test server|offscreen [frames]
+//
+//   server     no window nor renderer, layers tick at a fixed rate
+//   offscreen  the full renderer into a framebuffer object, needs EGL (Mesa)
+//
+// Exits with 77 (skipped) when the offscreen renderer can't start.
+
+#include "vv.hpp"
+#include "graphics/draw_item.hpp"
+#include "memory/alloc_profiler.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace vv;
+
+static constexpr int skipped = 77;
+static constexpr u32 guard_after_frames = 30;
+static u32 g_frames = 300;
+
+// Every kind of per-frame work a game does: events, fixed ticks, jobs, frame
+// arena containers, command recording, uploads and sorted draws
+class WorkLayer: public Layer
+{
+public:
+	Error init() override
+	{
+		// reserved once, steady state frames only rewrite it
+		m_positions.assign(vertex_count, 0.0f);
+
+		if( m_rend != nullptr )
+			m_mesh = m_rend->create_mesh(nullptr, vertex_count / 4, nullptr, 0, true);
+
+		return Error::ok;
+	}
+
+	void shutdown() override {}
+
+	void on_event( const SDL_Event & ) override {}
+
+	void fixed_update( double fixed_dt_sec ) override
+	{
+		m_time += fixed_dt_sec;
+	}
+
+	void update( double ) override
+	{
+		FrameAllocator<u32> allocator(m_app->frame_arena());
+		std::vector<u32, FrameAllocator<u32>> scratch(allocator);
+		scratch.resize(1024);
+
+		float *positions = m_positions.data();
+		float time = static_cast<float>(m_time);
+		m_app->jobs().parallel_for(0, vertex_count / 4, 0, [positions, time]( u32 begin, u32 end ) {
+			for(u32 i = begin; i < end; ++i)
+			{
+				positions[i * 4 + 0] = static_cast<float>(i % 32) / 16.0f - 1.0f + 0.01f * time;
+				positions[i * 4 + 1] = static_cast<float>(i / 32) / 16.0f - 1.0f;
+				positions[i * 4 + 2] = 0.0f;
+				positions[i * 4 + 3] = 1.0f;
+			}
+		});
+
+		if( ++m_frame == g_frames )
+			m_app->quit();
+	}
+
+	void render( double ) override
+	{
+		CommandList &list = m_rend->command_list();
+		list.push(ClearCmd{ 0.1f, 0.1f, 0.12f, 1.0f });
+
+		MeshBuffers buffers = m_rend->mesh_buffers(m_mesh);
+		if( buffers.vertex_array == 0 )
+			return; // not created yet
+
+		float *upload_data = list.arena().allocate_array<float>(vertex_count);
+		std::memcpy(upload_data, m_positions.data(), vertex_count * sizeof(float));
+
+		UploadBufferCmd upload;
+		upload.target = GL_ARRAY_BUFFER;
+		upload.buffer = buffers.vertex_buffer;
+		upload.size = vertex_count * sizeof(float);
+		upload.data = upload_data;
+		list.push(upload);
+
+		for(u32 i = 0; i < draw_count; ++i)
+		{
+			DrawItem item;
+			item.key = draw_key::make(0, i % 2 ? DrawPass::translucent : DrawPass::opaque, 0, i % 7, static_cast<float>(i) / draw_count);
+			item.vao = buffers.vertex_array;
+			item.mode = GL_POINTS;
+			item.count = vertex_count / 4 / draw_count;
+			item.first = static_cast<i32>(i * item.count);
+			list.submit_draw(item);
+		}
+	}
+
+private:
+	static constexpr u32 vertex_count = 1024 * 4;
+	static constexpr u32 draw_count = 64;
+
+	std::vector<float> m_positions;
+	MeshHandle m_mesh = 0;
+	double m_time = 0.0;
+	u32 m_frame = 0;
+};
+
+int main( int argc, char **argv )
+{
+	bool server = argc > 1 && std::strcmp(argv[1], "server") == 0;
+	bool offscreen = argc > 1 && std::strcmp(argv[1], "offscreen") == 0;
+	if( !server && !offscreen )
+	{
+		std::fprintf(stderr, "usage: %s server|offscreen [frames]\n", argv[0]);
+		return 1;
+	}
+
+	if( argc > 2 )
+		g_frames = static_cast<u32>(std::max<int>(guard_after_frames + 1, std::atoi(argv[2])));
+
+	if( !AllocProfiler::enabled )
+	{
+		std::fprintf(stderr, "built without VV_ALLOC_PROFILER, the guard can't run\n");
+		return 1;
+	}
+
+	EngineParameters params;
+	params.window_title = "vroum_alloc_guard_test";
+	params.window_width = 320;
+	params.window_height = 180;
+	params.target_fps = 0;
+	params.fixed_tick_rate = 60;
+	params.server = server;
+	params.server_tick_rate = 1000; // as fast as a server can tick, the test only counts frames
+	params.offscreen = offscreen;
+	params.show_stats_overlay = true;
+	params.alloc_guard_after_frames = guard_after_frames;
+	params.shader_cache_directory = "";
+	params.flight_recorder_path = "";
+
+	Engine engine(params);
+	if( !engine.init_systems() )
+		return offscreen ? skipped : 1;
+
+	engine.add_layer<WorkLayer>();
+	engine.run();
+	engine.shutdown_systems();
+
+	std::printf("%u frames, none allocated after frame %u\n", g_frames, guard_after_frames);
+	return 0;
+}
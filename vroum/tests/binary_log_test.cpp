@@ -0,0 +1,250 @@
+// Writes records with BinaryLogSink, decodes the file back and checks every
+// line against what format_log_record gives for the record as logged. Covers
+// a site written before and after its literals are settled, records of two
+// threads, a const char array changed between two calls, and a version 2 file.
+//
+//   vroum_binary_log_test [scratch file]
+
+#include "logger.hpp"
+#include "logging/binary_log_reader.hpp"
+#include "logging/binary_log_sink.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace vv;
+
+static int g_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if( !(condition) ) \
+		{ \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++g_failures; \
+		} \
+	} while(0)
+
+struct ExpectedLine
+{
+	u32 thread;
+	std::string text;
+};
+
+static std::string format( const LogSite &site, const unsigned char *args, u32 args_size )
+{
+	char line[log_max_line];
+	std::size_t length = format_log_record(site, args, args_size, line, sizeof(line));
+	return std::string(line, length);
+}
+
+// Hands every record of the logger to the binary sink, and keeps the line
+// the console would print for it
+class ForwardSink: public LogSink
+{
+public:
+	ForwardSink( BinaryLogSink &binary, std::vector<ExpectedLine> &expected ): m_binary(binary), m_expected(expected) {}
+
+	void write( const LogRecordView &record ) override
+	{
+		m_binary.write(record);
+		m_expected.push_back({ record.thread, format(record.site, record.args, record.args_size) });
+	}
+
+private:
+	BinaryLogSink &m_binary;
+	std::vector<ExpectedLine> &m_expected;
+};
+
+struct Config
+{
+	char name[16];
+};
+
+static void log_player( const Config &config, int score )
+{
+	VV_INFO("player", config.name, "score", score);
+}
+
+static std::vector<unsigned char> read_file( const std::string &path )
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static bool contains( const std::vector<DecodedLogEvent> &events, const char *text )
+{
+	for(const DecodedLogEvent &event: events)
+	{
+		if( event.text.find(text) != std::string::npos )
+			return true;
+	}
+	return false;
+}
+
+static void test_current_version( const std::string &path )
+{
+	std::vector<ExpectedLine> expected;
+	auto binary = std::make_unique<BinaryLogSink>(path);
+	CHECK(binary->is_open());
+
+	Logger::get().clear_sinks();
+	Logger::get().add_sink(std::make_unique<ForwardSink>(*binary, expected));
+
+	// a site whose literals aren't known yet when its first record reaches the
+	// sink: that record is written inline, the site is written again once settled
+	const char *file = "binary_log_test.cpp";
+	u32 site_id = Logger::register_site(LogLevel::info, file, 1);
+
+	unsigned char args[64];
+	unsigned char *end = log_args::write(log_args::write(args, "round"), 0);
+	LogSite unsettled;
+	unsettled.file = file;
+	unsettled.line = 1;
+	binary->write({ unsettled, site_id, 7, Logger::now(), args, static_cast<u32>(end - args) });
+	expected.push_back({ 7, format(unsettled, args, static_cast<u32>(end - args)) });
+
+	Logger::get().log(site_id, "round", 1);
+	Logger::get().flush();
+	CHECK(Logger::get().literals_settled(site_id));
+
+	// the same site, from another thread then from this one again
+	std::thread other([site_id]() {
+		Logger::get().log(site_id, "round", 2);
+		VV_WARN("from the other thread", 2.5, true, 'x');
+	});
+	other.join();
+	Logger::get().log(site_id, "round", 3);
+
+	// a const char array the site kept, that changes before the second call
+	Config config {};
+	std::snprintf(config.name, sizeof(config.name), "alice");
+	log_player(config, 10);
+	std::snprintf(config.name, sizeof(config.name), "bob");
+	log_player(config, 20);
+
+	Logger::get().flush();
+	Logger::get().clear_sinks();
+	binary.reset();
+
+	std::vector<unsigned char> data = read_file(path);
+	DecodedLog log;
+	CHECK(decode_binary_log(data.data(), data.size(), log));
+	CHECK(log.header.version == binary_log::version);
+	CHECK(log.bad_entry == 0);
+
+	CHECK(log.events.size() == expected.size());
+	for(std::size_t i = 0; i < log.events.size() && i < expected.size(); ++i)
+	{
+		CHECK(log.events[i].thread == expected[i].thread);
+		CHECK(log.events[i].text == expected[i].text);
+		if( log.events[i].text != expected[i].text )
+			std::fprintf(stderr, "  line %zu: decoded \"%s\", logged \"%s\"\n", i, log.events[i].text.c_str(), expected[i].text.c_str());
+	}
+
+	CHECK(log.sites[site_id].literals.size() == 1);
+	CHECK(contains(log.events, "player alice score 10"));
+	CHECK(contains(log.events, "player bob score 20"));
+}
+
+template <typename T>
+static void append( std::vector<unsigned char> &out, const T &value )
+{
+	const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void append_string( std::vector<unsigned char> &out, const char *str )
+{
+	append(out, static_cast<u16>(std::strlen(str)));
+	out.insert(out.end(), str, str + std::strlen(str));
+}
+
+// Version 2 as older builds wrote it: no literals in the sites, the thread
+// after the type byte of every record and zone
+static void test_version_2()
+{
+	std::vector<unsigned char> data;
+	binary_log::FileHeader header {};
+	std::memcpy(header.magic, binary_log::magic, sizeof(header.magic));
+	header.version = 2;
+	header.steady_start = 1000;
+	append(data, header);
+
+	data.push_back(binary_log::site_entry);
+	append(data, u32(10));
+	append(data, static_cast<u8>(LogLevel::warn));
+	append(data, u32(42));
+	append_string(data, "game.cpp");
+
+	data.push_back(binary_log::thread_entry);
+	append(data, u32(3));
+	append_string(data, "render");
+
+	unsigned char args[64];
+	unsigned char *end = log_args::write(log_args::write(args, "frame"), 12);
+	u32 args_size = static_cast<u32>(end - args);
+	data.push_back(binary_log::record_entry);
+	append(data, u32(10));
+	append(data, u32(3));
+	append(data, u64(2000));
+	append(data, args_size);
+	data.insert(data.end(), args, end);
+
+	data.push_back(binary_log::zone_entry);
+	append(data, u32(1));
+	append(data, u64(3000));
+	append(data, u64(1503000));
+	append_string(data, "upload");
+
+	data.push_back(binary_log::cause_entry);
+	append_string(data, "SIGSEGV");
+	data.push_back(0);
+
+	DecodedLog log;
+	CHECK(decode_binary_log(data.data(), data.size(), log));
+	CHECK(log.bad_entry == 0);
+	CHECK(log.cause == "SIGSEGV");
+	CHECK(log.thread_names[3] == "render");
+
+	LogSite site;
+	site.level = LogLevel::warn;
+	site.line = 42;
+	CHECK(log.events.size() == 2);
+	if( log.events.size() == 2 )
+	{
+		CHECK(log.events[0].thread == 3);
+		CHECK(log.events[0].timestamp == 2000);
+		CHECK(log.events[0].text == format(site, args, args_size));
+		CHECK(log.events[1].thread == 1);
+		CHECK(log.events[1].site == DecodedLog::no_site);
+		CHECK(log.events[1].text == "[ZONE ]: upload 1.500 ms\n");
+	}
+
+	// a newer version than this build knows is refused
+	reinterpret_cast<binary_log::FileHeader*>(data.data())->version = binary_log::version + 1;
+	CHECK(!decode_binary_log(data.data(), data.size(), log));
+}
+
+int main( int argc, char **argv )
+{
+	std::string path = argc > 1 ? argv[1] : "vroum_binary_log_test.vvlog";
+
+	test_current_version(path);
+	test_version_2();
+	std::remove(path.c_str());
+
+	if( g_failures != 0 )
+	{
+		std::fprintf(stderr, "%d checks failed\n", g_failures);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+// vroum_logdecode: turns the files written by vv::BinaryLogSink and the
+// flight recorder dumps back into text
+//
+//   vroum_logdecode <file> [--sites]
+//
+// Every record is printed as the console prints it, prefixed with the time
+// relative to the file header (the opening of the log, or the moment of the
+// dump) and the thread that logged it. --sites also prints the file and line
+// of each record.
+
+#include "logging/binary_log_reader.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace vv;
+
+// time, thread and site before the record text
+static constexpr int prefix_capacity = 512;
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		std::fprintf(stderr, "usage: %s <file> [--sites]\n", argv[0]);
+		return 1;
+	}
+
+	bool print_sites = argc > 2 && std::strcmp(argv[2], "--sites") == 0;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if( !file )
+	{
+		std::fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	DecodedLog log;
+	if( !decode_binary_log(data.data(), data.size(), log) )
+	{
+		std::fprintf(stderr, "%s: not a binary log, or an unsupported version\n", argv[1]);
+		return 1;
+	}
+
+	if( log.bad_entry != 0 )
+		std::fprintf(stderr, "%s: unexpected entry at offset %zu, stopping\n", argv[1], log.bad_entry);
+
+	// sink files are already in order, dumps come one thread after the other
+	std::stable_sort(log.events.begin(), log.events.end(), []( const DecodedLogEvent &a, const DecodedLogEvent &b ) {
+		return a.timestamp < b.timestamp;
+	});
+
+	if( !log.cause.empty() )
+		std::printf("-- dump: %s, times are relative to the dump --\n", log.cause.c_str());
+
+	for(const DecodedLogEvent &event: log.events)
+	{
+		char prefix[prefix_capacity];
+		double seconds = (static_cast<double>(event.timestamp) - static_cast<double>(log.header.steady_start)) * 1e-9;
+		auto name = log.thread_names.find(event.thread);
+		int length = name != log.thread_names.end()
+			? std::snprintf(prefix, prefix_capacity, "[%+.6f] [t%u %s] ", seconds, event.thread, name->second.c_str())
+			: std::snprintf(prefix, prefix_capacity, "[%+.6f] [t%u] ", seconds, event.thread);
+		length = std::min<int>(length, prefix_capacity - 1);
+
+		auto site = log.sites.find(event.site);
+		if( print_sites && site != log.sites.end() && !site->second.file.empty() )
+		{
+			length += std::snprintf(prefix + length, prefix_capacity - length, "%s:%u ", site->second.file.c_str(), site->second.site.line);
+			length = std::min<int>(length, prefix_capacity - 1);
+		}
+
+		std::fwrite(prefix, 1, length, stdout);
+		std::fwrite(event.text.data(), 1, event.text.size(), stdout);
+	}
+
+	std::fprintf(stderr, "%zu events\n", log.events.size());
+	return 0;
+}